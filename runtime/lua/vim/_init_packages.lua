@@ -16,7 +16,11 @@ end
 function vim._load_package(name)
   local basename = name:gsub('%.', '/')
   local paths = { 'lua/' .. basename .. '.lua', 'lua/' .. basename .. '/init.lua' }
+  local start = vim._time_span and vim.uv.hrtime()
   local found = vim.api.nvim__get_runtime(paths, false, { is_lua = true })
+  if start then
+    vim._time_span(("find('%s')"):format(name), start)
+  end
   if #found > 0 then
     local f, err = loadfile(found[1])
     return f or error(err)
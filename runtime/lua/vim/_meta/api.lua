@@ -140,6 +140,16 @@ function vim.api.nvim__runtime_inspect() end
 --- @param path string
 function vim.api.nvim__screenshot(path) end
 
+--- Gets the recent stalls of the main loop, see 'stalltime'.
+---
+--- @return any[] # Array of the last 100 stalls, oldest first, each a dictionary with:
+---   - "time"      When the stall ended, in seconds since the epoch
+---   - "duration"  How long the main loop was busy, in milliseconds
+---   - "activity"  What was running when the stall was detected: event
+---                 handlers, RPC methods, autocommands and Lua callbacks
+---                 (as "file:line"), outermost first, separated by " > "
+function vim.api.nvim__stalls() end
+
 --- Gets internal stats.
 ---
 --- @return table<string,any> # Map of various internal stats.
@@ -384,6 +394,18 @@ function vim.api.nvim_buf_get_extmark_by_id(buffer, ns_id, id, opts) end
 --- Note: For a reverse range, `limit` does not actually affect the traversed
 --- range, just how many marks are returned
 ---
+--- To get many marks in pages, pass the id of the last mark of a page as
+--- `after` to get the next one:
+---
+--- ```lua
+--- local page = vim.api.nvim_buf_get_extmarks(0, ns, 0, -1, { limit = 100 })
+--- while #page > 0 do
+---   -- ... use the marks ...
+---   local after = page[#page][1]
+---   page = vim.api.nvim_buf_get_extmarks(0, ns, 0, -1, { limit = 100, after = after })
+--- end
+--- ```
+---
 --- Note: when using extmark ranges (marks with a end_row/end_col position)
 --- the `overlap` option might be useful. Otherwise only the start position
 --- of an extmark will be considered.
@@ -421,7 +443,15 @@ function vim.api.nvim_buf_get_extmark_by_id(buffer, ns_id, id, opts) end
 --- - hl_name: Whether to include highlight group name instead of id, true if omitted
 --- - overlap: Also include marks which overlap the range, even if
 ---            their start position is less than `start`
---- - type: Filter marks by type: "highlight", "sign", "virt_text" and "virt_lines"
+--- - type: Filter marks by type: "highlight", "sign", "virt_text" and "virt_lines".
+--- - hl_group: Only return marks which highlight a range with this
+---             highlight group (name or id)
+--- - after: Continue after the mark with this id, returned last by a
+---          previous call with `limit`. Requires a namespace, not
+---          allowed with `overlap` or a reverse range. It is an error
+---          when the mark was deleted since, then pass its position
+---          as `start` instead, marks at that position are returned
+---          again.
 --- @return vim.api.keyset.get_extmark_item[] # List of `[extmark_id, row, col, details?]` tuples in "traversal order". For the
 --- `details` dictionary, see |nvim_buf_get_extmark_by_id()|.
 function vim.api.nvim_buf_get_extmarks(buffer, ns_id, start, end_, opts) end
@@ -1520,6 +1550,25 @@ function vim.api.nvim_get_option_info2(name, opts) end
 --- @return any # Option value
 function vim.api.nvim_get_option_value(name, opts) end
 
+--- Gets the values of several options at once. Like calling
+--- `nvim_get_option_value()` for each of them, but the window or buffer is
+--- entered only once.
+---
+--- @param names string[] Option names
+--- @param opts vim.api.keyset.option Optional parameters, like for
+--- `nvim_get_option_value()`
+--- - scope: One of "global" or "local". Analogous to
+--- `:setglobal` and `:setlocal`, respectively.
+--- - win: `window-ID`. Used for getting window local options.
+--- - buf: Buffer number. Used for getting buffer local options.
+---        Implies {scope} is "local".
+--- - filetype: `filetype`. Used to get the default options for a
+---   specific filetype. Cannot be used with any other option.
+---   Note: this will trigger `ftplugin` and all `FileType`
+---   autocommands for the corresponding filetype, once.
+--- @return table<string,any> # Dict of the option names and their values
+function vim.api.nvim_get_options(names, opts) end
+
 --- Gets info describing process `pid`.
 ---
 --- @param pid integer
@@ -2292,6 +2341,31 @@ function vim.api.nvim_set_option(name, value) end
 --- - buf: Buffer number. Used for setting buffer local option.
 function vim.api.nvim_set_option_value(name, value, opts) end
 
+--- Sets the values of several options at once. Like calling
+--- `nvim_set_option_value()` for each of them, but faster: the window or
+--- buffer is entered only once, and the redraw needed by the options is
+--- determined once, after all of them were set.
+---
+--- All names and value types are checked before any option is set. If an
+--- option then cannot be set, the error is returned and the options after it
+--- (in unspecified order) are not set.
+---
+--- Example: configure a floating window:
+---
+--- ```lua
+--- vim.api.nvim_set_options({ number = false, wrap = false, winhighlight = 'Normal:Pmenu' },
+---   { win = win })
+--- ```
+---
+--- @param values table<string,any> Dict of option names and values
+--- @param opts vim.api.keyset.option Optional parameters, like for
+--- `nvim_set_option_value()`
+--- - scope: One of "global" or "local". Analogous to
+--- `:setglobal` and `:setlocal`, respectively.
+--- - win: `window-ID`. Used for setting window local options.
+--- - buf: Buffer number. Used for setting buffer local options.
+function vim.api.nvim_set_options(values, opts) end
+
 --- Sets a global (g:) variable.
 ---
 --- @param name string Variable name
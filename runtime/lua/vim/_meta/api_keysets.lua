@@ -9,6 +9,7 @@ error('Cannot require a meta file')
 --- @field on_changedtick? fun(_: "changedtick", bufnr: integer, changedtick: integer)
 --- @field on_detach? fun(_: "detach", bufnr: integer)
 --- @field on_reload? fun(_: "reload", bufnr: integer)
+--- @field on_changes? fun(_: "changes", bufnr: integer, changedtick: integer, changes?: integer[]): boolean?
 --- @field utf_sizes? boolean
 --- @field preview? boolean
 
@@ -282,6 +283,8 @@ error('Cannot require a meta file')
 --- @field hl_name? boolean
 --- @field overlap? boolean
 --- @field type? string
+--- @field hl_group? integer|string
+--- @field after? integer
 
 --- @class vim.api.keyset.get_highlight
 --- @field id? integer
@@ -105,6 +105,27 @@ function vim.rpcnotify(channel, method, ...) end
 --- @param ...? any
 function vim.rpcrequest(channel, method, ...) end
 
+--- Iterates over lines of buffer {bufnr}, reading them directly from the buffer storage. Unlike
+--- [nvim_buf_get_lines()] this does not build a table holding the whole range, so it is suited
+--- for scanning large buffers, or stopping early. Indexing is zero-based, end-exclusive, and
+--- negative {end_} is interpreted like in [nvim_buf_get_lines()].
+---
+--- Example:
+---
+--- ```lua
+--- for row, line in vim.buf_lines(0) do
+---   if line:find('TODO') then
+---     print(row, line)
+---   end
+--- end
+--- ```
+---
+--- @param bufnr integer Buffer handle, or 0 for current buffer
+--- @param start? integer First line index (default: 0)
+--- @param end_? integer Last line index, exclusive (default: -1)
+--- @return fun(): integer?, string? : Iterator returning the zero-based row and the line text.
+function vim.buf_lines(bufnr, start, end_) end
+
 --- Compares strings case-insensitively.
 --- @param a string
 --- @param b string
@@ -5781,6 +5781,20 @@ vim.o.sd = vim.o.shada
 vim.go.shada = vim.o.shada
 vim.go.sd = vim.go.shada
 
+--- When on, `:wshada` without [!] only merges and serializes the
+--- `shada-file` in the main loop.  Writing the result to disk, calling
+--- fsync() (see 'fsync') and renaming it over the ShaDa file is done in
+--- the background, so that writing the ShaDa file from a timer or an
+--- autocommand does not block editing.  Errors are reported later.
+--- Reading or writing the ShaDa file again, and exiting Nvim, first
+--- waits for the background write to finish.
+---
+--- @type boolean
+vim.o.shadaasync = false
+vim.o.sda = vim.o.shadaasync
+vim.go.shadaasync = vim.o.shadaasync
+vim.go.sda = vim.go.shadaasync
+
 --- When non-empty, overrides the file name used for `shada` (viminfo).
 --- When equal to "NONE" no shada file will be read or written.
 --- This option can be set with the `-i` command line flag.  The `--clean`
@@ -6638,6 +6652,20 @@ vim.o.spr = vim.o.splitright
 vim.go.splitright = vim.o.splitright
 vim.go.spr = vim.go.splitright
 
+--- When non-zero, a watchdog thread logs to `$NVIM_LOG_FILE` when the
+--- main loop is busy for more than this many milliseconds without
+--- checking for input or events, e.g. because a plugin callback takes
+--- long.  The log shows what was running: the event handler, RPC method,
+--- autocommand and Lua callback, outermost first.  The last 100 stalls
+--- can be obtained with `nvim__stalls()`.
+--- When zero, the watchdog is not running.
+---
+--- @type integer
+vim.o.stalltime = 0
+vim.o.stt = vim.o.stalltime
+vim.go.stalltime = vim.o.stalltime
+vim.go.stt = vim.go.stalltime
+
 --- When "on" the commands listed below move the cursor to the first
 --- non-blank of the line.  When off the cursor is kept in the same column
 --- (if possible).  This applies to the commands:
@@ -35,3 +35,22 @@ function regex:match_str(str) end
 --- @return integer? # match start (byte index) relative to `start`, or `nil` if no match
 --- @return integer? # match end (byte index) relative to `start`, or `nil` if no match
 function regex:match_line(bufnr, line_idx, start, end_) end
+
+--- Matches lines `start` to `end_` (zero-based, end-exclusive) in buffer `bufnr`, and returns an
+--- iterator over the matching lines. Matching is done directly on the buffer text, so lines that
+--- don't match are never copied to Lua. Negative `end_` is interpreted like in
+--- |nvim_buf_get_lines()|.
+---
+--- ```lua
+--- local re = vim.regex([[\<TODO\>]])
+--- for row, s, e in re:match_lines(0) do
+---   print(('TODO at %d:%d-%d'):format(row, s, e))
+--- end
+--- ```
+---
+--- @param bufnr integer
+--- @param start? integer (default: 0)
+--- @param end_? integer (default: -1)
+--- @return fun(): integer?, integer?, integer? : Iterator returning the row, and the start and end
+--- byte indices of the match.
+function regex:match_lines(bufnr, start, end_) end
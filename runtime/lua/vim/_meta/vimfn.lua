@@ -2575,6 +2575,26 @@ vim.fn['function'] = function(name, arglist, dict) end
 --- @return any
 function vim.fn.garbagecollect(atexit) end
 
+--- Return a |Dictionary| with statistics about the garbage
+--- collection of |Lists| and |Dictionaries| with circular
+--- references, see |garbagecollect()|.  Entries:
+---   count		number of completed collections
+---   interrupted	number of collections that were abandoned
+--- 		because a key was typed while they were running
+---   skipped	number of collections that were not done, because
+--- 		no reference was dropped since the last one
+---   last		duration of the last collection in msec (Float)
+---   max		duration of the longest collection in msec
+---   total		total time spent collecting in msec
+---
+--- The collection done while waiting for a key after
+--- 'updatetime' is abandoned when typeahead arrives, so that it
+--- does not delay typing.  It then runs again the next time Nvim
+--- is idle.
+---
+--- @return table
+function vim.fn.gcstats() end
+
 --- Get item {idx} from |List| {list}.  When this item is not
 --- available return {default}.  Return zero when {default} is
 --- omitted.
@@ -193,7 +193,11 @@ end
 --- @return string|function
 local function loader_cached(modname)
   fs_stat_cache = {}
+  local start = vim._time_span and uv.hrtime()
   local ret = M.find(modname)[1]
+  if start then
+    vim._time_span(("vim.loader: find('%s')"):format(modname), start)
+  end
   if ret then
     -- Make sure to call the global loadfile so we respect any augmentations done elsewhere.
     -- E.g. profiling
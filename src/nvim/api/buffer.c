@@ -149,6 +149,17 @@ Integer nvim_buf_line_count(Buffer buffer, Error *err)
 ///               typically re-fetch the entire buffer contents. Args:
 ///               - the string "reload"
 ///               - buffer id
+///             - on_changes: Called from the main loop with the changes made since it was
+///               last called, for example once for a whole macro or |:substitute|. Changes
+///               which continue where the previous one ended are merged. Not called on
+///               buffer reload, nor for command preview. Return a [lua-truthy] value to
+///               detach. Args:
+///               - the string "changes"
+///               - buffer id
+///               - b:changedtick
+///               - the changes, as a flat list with the nine `on_bytes` arguments
+///                 from start row to new end byte length for each change, or nil if
+///                 there were too many changes: re-read the buffer then.
 ///             - utf_sizes: include UTF-32 and UTF-16 size of the replaced
 ///               region, as args to `on_lines`.
 ///             - preview: also attach to command preview (i.e. 'inccommand')
@@ -194,6 +205,11 @@ Boolean nvim_buf_attach(uint64_t channel_id, Buffer buffer, Boolean send_buffer,
       opts->on_reload = LUA_NOREF;
     }
 
+    if (HAS_KEY(opts, buf_attach, on_changes)) {
+      cb.on_changes = opts->on_changes;
+      opts->on_changes = LUA_NOREF;
+    }
+
     cb.utf_sizes = opts->utf_sizes;
 
     cb.preview = opts->preview;
@@ -250,6 +250,18 @@ nvim_buf_get_extmark_by_id(Buffer buffer, Integer ns_id, Integer id, Dict(get_ex
 /// Note: For a reverse range, `limit` does not actually affect the traversed
 /// range, just how many marks are returned
 ///
+/// To get many marks in pages, pass the id of the last mark of a page as
+/// `after` to get the next one:
+///
+/// ```lua
+/// local page = vim.api.nvim_buf_get_extmarks(0, ns, 0, -1, { limit = 100 })
+/// while #page > 0 do
+///   -- ... use the marks ...
+///   local after = page[#page][1]
+///   page = vim.api.nvim_buf_get_extmarks(0, ns, 0, -1, { limit = 100, after = after })
+/// end
+/// ```
+///
 /// Note: when using extmark ranges (marks with a end_row/end_col position)
 /// the `overlap` option might be useful. Otherwise only the start position
 /// of an extmark will be considered.
@@ -287,7 +299,15 @@ nvim_buf_get_extmark_by_id(Buffer buffer, Integer ns_id, Integer id, Dict(get_ex
 ///          - hl_name: Whether to include highlight group name instead of id, true if omitted
 ///          - overlap: Also include marks which overlap the range, even if
 ///                     their start position is less than `start`
-///          - type: Filter marks by type: "highlight", "sign", "virt_text" and "virt_lines"
+///          - type: Filter marks by type: "highlight", "sign", "virt_text" and "virt_lines".
+///          - hl_group: Only return marks which highlight a range with this
+///                      highlight group (name or id)
+///          - after: Continue after the mark with this id, returned last by a
+///                   previous call with `limit`. Requires a namespace, not
+///                   allowed with `overlap` or a reverse range. It is an error
+///                   when the mark was deleted since, then pass its position
+///                   as `start` instead, marks at that position are returned
+///                   again.
 /// @param[out] err   Error details, if any
 /// @return List of `[extmark_id, row, col, details?]` tuples in "traversal order". For the
 /// `details` dictionary, see |nvim_buf_get_extmark_by_id()|.
@@ -328,6 +348,14 @@ ArrayOf(DictAs(get_extmark_item)) nvim_buf_get_extmarks(Buffer buffer, Integer n
     }
   }
 
+  int hl_filter = 0;
+  if (HAS_KEY(opts, get_extmarks, hl_group)) {
+    hl_filter = (int)opts->hl_group;
+    if (hl_filter == 0) {
+      return rv;
+    }
+  }
+
   Integer limit = HAS_KEY(opts, get_extmarks, limit) ? opts->limit : -1;
 
   if (limit == 0) {
@@ -360,9 +388,24 @@ ArrayOf(DictAs(get_extmark_item)) nvim_buf_get_extmarks(Buffer buffer, Integer n
     u_col = col;
   }
 
+  uint32_t after = 0;
+  if (HAS_KEY(opts, get_extmarks, after)) {
+    VALIDATE((ns_id != -1 && !opts->overlap && !reverse), "%s",
+             "'after' requires a namespace and cannot be used with 'overlap' or a reverse range", {
+      return rv;
+    });
+    VALIDATE_INT((opts->after > 0
+                  && extmark_from_id(buf, (uint32_t)ns_id,
+                                     (uint32_t)opts->after).start.pos.row >= 0),
+                 "after", opts->after, {
+      return rv;
+    });
+    after = (uint32_t)opts->after;
+  }
+
   // note: ns_id=-1 allowed, represented as UINT32_MAX
-  ExtmarkInfoArray marks = extmark_get(buf, (uint32_t)ns_id, l_row, l_col, u_row,
-                                       u_col, (int64_t)limit, type, opts->overlap);
+  ExtmarkInfoArray marks = extmark_get(buf, (uint32_t)ns_id, l_row, l_col, u_row, u_col,
+                                       (int64_t)limit, type, hl_filter, opts->overlap, after);
 
   rv = arena_array(arena, MIN(kv_size(marks), rv_limit));
   if (reverse) {
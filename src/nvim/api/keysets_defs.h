@@ -79,6 +79,8 @@ typedef struct {
   Boolean hl_name;
   Boolean overlap;
   String type;
+  HLGroupID hl_group;
+  Integer after;
 } Dict(get_extmarks);
 
 typedef struct {
@@ -377,6 +379,10 @@ typedef struct {
   LuaRefOf(("changedtick" _, Integer bufnr, Integer changedtick)) on_changedtick;
   LuaRefOf(("detach" _, Integer bufnr)) on_detach;
   LuaRefOf(("reload" _, Integer bufnr)) on_reload;
+  LuaRefOf(("changes" _,
+            Integer bufnr,
+            Integer changedtick,
+            ArrayOf(Integer) *changes), *Boolean) on_changes;
   Boolean utf_sizes;
   Boolean preview;
 } Dict(buf_attach);
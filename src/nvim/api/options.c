@@ -24,6 +24,16 @@
 static int validate_option_value_args(Dict(option) *opts, char *name, OptIndex *opt_idxp,
                                       int *opt_flags, OptScope *scope, void **from, char **filetype,
                                       Error *err)
+{
+  if (!validate_option_scope_args(opts, opt_flags, scope, from, filetype, err)) {
+    return FAIL;
+  }
+  return validate_option_name(name, *scope, opt_idxp, err);
+}
+
+/// Validates the {opts} of the option functions: where to get or set options.
+static int validate_option_scope_args(Dict(option) *opts, int *opt_flags, OptScope *scope,
+                                      void **from, char **filetype, Error *err)
 {
 #define HAS_KEY_X(d, v) HAS_KEY(d, option, v)
   if (HAS_KEY_X(opts, scope)) {
@@ -76,14 +86,21 @@ static int validate_option_value_args(Dict(option) *opts, char *name, OptIndex *
     return FAIL;
   });
 
+  return OK;
+#undef HAS_KEY_X
+}
+
+/// Finds option "name" and checks that it can be used with "scope".
+static int validate_option_name(char *name, OptScope scope, OptIndex *opt_idxp, Error *err)
+{
   *opt_idxp = find_option(name);
   if (*opt_idxp == kOptInvalid) {
     // unknown option
     api_set_error(err, kErrorTypeValidation, "Unknown option '%s'", name);
-  } else if (*scope == kOptScopeBuf || *scope == kOptScopeWin) {
+  } else if (scope == kOptScopeBuf || scope == kOptScopeWin) {
     // if 'buf' or 'win' is passed, make sure the option supports it
-    if (!option_has_scope(*opt_idxp, *scope)) {
-      char *tgt = *scope == kOptScopeBuf ? "buf" : "win";
+    if (!option_has_scope(*opt_idxp, scope)) {
+      char *tgt = scope == kOptScopeBuf ? "buf" : "win";
       char *global = option_has_scope(*opt_idxp, kOptScopeGlobal) ? "global " : "";
       char *req = option_has_scope(*opt_idxp, kOptScopeBuf)
                   ? "buffer-local "
@@ -95,7 +112,6 @@ static int validate_option_value_args(Dict(option) *opts, char *name, OptIndex *
   }
 
   return ERROR_SET(err) ? FAIL : OK;
-#undef HAS_KEY_X
 }
 
 /// Create a dummy buffer and run the FileType autocmd on it.
@@ -259,6 +275,144 @@ void nvim_set_option_value(uint64_t channel_id, String name, Object value, Dict(
   });
 }
 
+/// Sets the values of several options at once. Like calling |nvim_set_option_value()| for each
+/// of them, but faster: the window or buffer is entered only once, and the redraw needed by the
+/// options is determined once, after all of them were set.
+///
+/// All names and value types are checked before any option is set. If an option then cannot be
+/// set, the error is returned and the options after it (in unspecified order) are not set.
+///
+/// Example: configure a floating window: >lua
+///   vim.api.nvim_set_options({ number = false, wrap = false, winhighlight = 'Normal:Pmenu' },
+///     { win = win })
+/// <
+///
+/// @param values    Dict of option names and values
+/// @param opts      Optional parameters, like for |nvim_set_option_value()|
+///                  - scope: One of "global" or "local". Analogous to
+///                  |:setglobal| and |:setlocal|, respectively.
+///                  - win: |window-ID|. Used for setting window local options.
+///                  - buf: Buffer number. Used for setting buffer local options.
+/// @param[out] err  Error details, if any
+void nvim_set_options(uint64_t channel_id, Dict values, Dict(option) *opts, Arena *arena,
+                      Error *err)
+  FUNC_API_SINCE(14)
+{
+  int opt_flags = 0;
+  OptScope scope = kOptScopeGlobal;
+  void *to = NULL;
+  if (!validate_option_scope_args(opts, &opt_flags, &scope, &to, NULL, err)) {
+    return;
+  }
+
+  const char **names = arena_alloc(arena, values.size * sizeof(*names), true);
+  OptIndex *opt_idxs = arena_alloc(arena, values.size * sizeof(*opt_idxs), true);
+  OptVal *optvals = arena_alloc(arena, values.size * sizeof(*optvals), true);
+  int *flags = arena_alloc(arena, values.size * sizeof(*flags), true);
+
+  for (size_t i = 0; i < values.size; i++) {
+    names[i] = values.items[i].key.data;
+    if (!validate_option_name(values.items[i].key.data, scope, &opt_idxs[i], err)) {
+      return;
+    }
+
+    // Like nvim_set_option_value(): with a window and no scope, do not change the global value
+    // of a global-local option.
+    flags[i] = opt_flags;
+    if (scope == kOptScopeWin && opt_flags == 0
+        && option_has_scope(opt_idxs[i], kOptScopeGlobal)) {
+      flags[i] = OPT_LOCAL;
+    }
+
+    bool error = false;
+    optvals[i] = object_as_optval(values.items[i].value, &error);
+    VALIDATE_EXP(!error, "value", "valid option type", api_typename(values.items[i].value.type), {
+      return;
+    });
+  }
+
+  WITH_SCRIPT_CONTEXT(channel_id, {
+    set_options_value_for(names, opt_idxs, optvals, flags, values.size, scope, to, err);
+  });
+}
+
+/// Gets the values of several options at once. Like calling |nvim_get_option_value()| for each
+/// of them, but the window or buffer is entered only once.
+///
+/// @param names     Option names
+/// @param opts      Optional parameters, like for |nvim_get_option_value()|
+///                  - scope: One of "global" or "local". Analogous to
+///                  |:setglobal| and |:setlocal|, respectively.
+///                  - win: |window-ID|. Used for getting window local options.
+///                  - buf: Buffer number. Used for getting buffer local options.
+///                         Implies {scope} is "local".
+///                  - filetype: |filetype|. Used to get the default options for a
+///                    specific filetype. Cannot be used with any other option.
+///                    Note: this will trigger |ftplugin| and all |FileType|
+///                    autocommands for the corresponding filetype, once.
+/// @param[out] err  Error details, if any
+/// @return          Dict of the option names and their values
+Dict nvim_get_options(ArrayOf(String) names, Dict(option) *opts, Error *err)
+  FUNC_API_SINCE(14) FUNC_API_RET_ALLOC
+{
+  Dict rv = ARRAY_DICT_INIT;
+  int opt_flags = 0;
+  OptScope scope = kOptScopeGlobal;
+  void *from = NULL;
+  char *filetype = NULL;
+  if (!validate_option_scope_args(opts, &opt_flags, &scope, &from, &filetype, err)) {
+    return rv;
+  }
+
+  for (size_t i = 0; i < names.size; i++) {
+    VALIDATE_T("name", kObjectTypeString, names.items[i].type, {
+      return rv;
+    });
+  }
+
+  OptIndex *opt_idxs = xmalloc(names.size * sizeof(*opt_idxs));
+  OptVal *optvals = NULL;
+  aco_save_T aco;
+  buf_T *ftbuf = NULL;
+  for (size_t i = 0; i < names.size; i++) {
+    if (!validate_option_name(names.items[i].data.string.data, scope, &opt_idxs[i], err)) {
+      goto theend;
+    }
+  }
+
+  ftbuf = do_ft_buf(filetype, &aco, err);
+  if (ftbuf != NULL) {
+    assert(!from);
+    from = ftbuf;
+  }
+
+  if (!ERROR_SET(err)) {
+    optvals = xmalloc(names.size * sizeof(*optvals));
+    get_options_value_for(opt_idxs, optvals, names.size, opt_flags, scope, from, err);
+  }
+
+  if (ftbuf != NULL) {
+    // restore curwin/curbuf and a few other things
+    aucmd_restbuf(&aco);
+
+    assert(curbuf != ftbuf);  // safety check
+    wipe_buffer(ftbuf, false);
+  }
+
+  if (ERROR_SET(err)) {
+    goto theend;
+  }
+
+  for (size_t i = 0; i < names.size; i++) {
+    PUT(rv, names.items[i].data.string.data, optval_as_object(optvals[i]));
+  }
+
+theend:
+  xfree(opt_idxs);
+  xfree(optvals);
+  return rv;
+}
+
 /// Gets the option information for all options.
 ///
 /// The dict has the full option names as keys and option metadata dicts as detailed at
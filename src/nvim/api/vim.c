@@ -84,6 +84,7 @@
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 #include "nvim/vim_defs.h"
+#include "nvim/watchdog.h"
 #include "nvim/window.h"
 
 #include "api/vim.c.generated.h"
@@ -1785,6 +1786,19 @@ Dict nvim__stats(Arena *arena)
   return rv;
 }
 
+/// Gets the recent stalls of the main loop, see 'stalltime'.
+///
+/// @return Array of the last 100 stalls, oldest first, each a dictionary with:
+///   - "time"      When the stall ended, in seconds since the epoch
+///   - "duration"  How long the main loop was busy, in milliseconds
+///   - "activity"  What was running when the stall was detected: event
+///                 handlers, RPC methods, autocommands and Lua callbacks
+///                 (as "file:line"), outermost first, separated by " > "
+Array nvim__stalls(Arena *arena)
+{
+  return watchdog_stalls(arena);
+}
+
 /// Gets a list of dictionaries representing attached UIs.
 ///
 /// Example: The Nvim builtin |TUI| sets its channel info as described in |startup-tui|. In
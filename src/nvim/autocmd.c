@@ -59,6 +59,7 @@
 #include "nvim/ui.h"
 #include "nvim/ui_compositor.h"
 #include "nvim/vim_defs.h"
+#include "nvim/watchdog.h"
 #include "nvim/window.h"
 #include "nvim/winfloat.h"
 
@@ -1058,6 +1059,7 @@ int autocmd_register(int64_t id, event_T event, const char *pat, int patlen, int
     ap->refcount = 0;
     ap->pat = xmemdupz(pat, (size_t)patlen);
     ap->patlen = patlen;
+    aupat_classify(ap);
 
     // need to initialize last_mode for the first ModeChanged autocmd
     if (event == EVENT_MODECHANGED && !has_event(EVENT_MODECHANGED)) {
@@ -1880,6 +1882,11 @@ bool apply_autocmds_group(event_T event, char *fname, char *fname_io, bool force
 
   // name and lnum are filled in later
   estack_push(ETYPE_AUCMD, NULL, 0);
+  char activity[100] = "";
+  if (watchdog_active()) {
+    vim_snprintf(activity, sizeof(activity), "%s %s", event_nr2name(event), autocmd_match);
+  }
+  watchdog_activity_push("autocmd", activity);
 
   const sctx_T save_current_sctx = current_sctx;
 
@@ -1990,6 +1997,7 @@ bool apply_autocmds_group(event_T event, char *fname, char *fname_io, bool force
   autocmd_nested = save_autocmd_nested;
   xfree(SOURCING_NAME);
   estack_pop();
+  watchdog_activity_pop();
   xfree(afile_orig);
   xfree(autocmd_fname);
   autocmd_fname = save_autocmd_fname;
@@ -2086,6 +2094,72 @@ bool is_autocmd_blocked(void)
   return autocmd_blocked != 0;
 }
 
+/// Find out whether "ap" can be matched without using its regprog, so that the
+/// many "*.ext" and "filetype" patterns do not each run the regexp engine.
+static void aupat_classify(AutoPat *ap)
+{
+  ap->kind = kAuPatRegex;
+  ap->lit = NULL;
+  ap->litlen = 0;
+  if (ap->buflocal_nr != 0) {
+    return;
+  }
+
+  const char *const pat = ap->pat;
+  const size_t len = (size_t)ap->patlen;
+  size_t lead = 0;
+  while (lead < len && pat[lead] == '*') {
+    lead++;
+  }
+  if (lead == len) {
+    ap->kind = len > 0 ? kAuPatAny : kAuPatRegex;
+    return;
+  }
+  size_t trail = 0;
+  while (pat[len - 1 - trail] == '*') {
+    trail++;
+  }
+  if (lead > 0 && trail > 0) {
+    return;
+  }
+  // Only printable ASCII that is not special in a file pattern or a regexp.
+  for (size_t i = lead; i < len - trail; i++) {
+    const uint8_t c = (uint8_t)pat[i];
+    if (c < ' ' || c > '~' || vim_strchr("*?[]{},\\/~^$", c) != NULL) {
+      return;
+    }
+  }
+
+  ap->lit = pat + lead;
+  ap->litlen = len - lead - trail;
+  ap->kind = lead > 0 ? kAuPatSuffix : trail > 0 ? kAuPatPrefix : kAuPatExact;
+}
+
+/// Check if AutoPat "ap" matches a file name, see match_file_pat().
+static bool aupat_match(AutoPat *ap, char *fname, char *sfname, char *tail)
+{
+  if (ap->kind == kAuPatRegex) {
+    return match_file_pat(NULL, &ap->reg_prog, fname, sfname, tail, ap->allow_dirs);
+  } else if (ap->kind == kAuPatAny) {
+    return true;
+  }
+
+  const size_t len = strlen(tail);
+  if (p_fic) {
+    // Ignoring case of non-ASCII characters is left to the regexp engine.
+    for (size_t i = 0; i < len; i++) {
+      if ((uint8_t)tail[i] >= 0x80) {
+        return match_file_pat(NULL, &ap->reg_prog, fname, sfname, tail, ap->allow_dirs);
+      }
+    }
+  }
+  if (len < ap->litlen || (ap->kind == kAuPatExact && len != ap->litlen)) {
+    return false;
+  }
+  const char *const s = ap->kind == kAuPatSuffix ? tail + len - ap->litlen : tail;
+  return p_fic ? STRNICMP(s, ap->lit, ap->litlen) == 0 : memcmp(s, ap->lit, ap->litlen) == 0;
+}
+
 /// Find next matching autocommand.
 /// If next autocommand was not found, sets lastpat to NULL and cmdidx to SIZE_MAX on apc.
 static void aucmd_next(AutoPatCmd *apc)
@@ -2110,7 +2184,7 @@ static void aucmd_next(AutoPatCmd *apc)
       }
       // Skip autocommands that don't match the pattern or buffer number.
       if (ap->buflocal_nr == 0
-          ? !match_file_pat(NULL, &ap->reg_prog, apc->fname, apc->sfname, apc->tail, ap->allow_dirs)
+          ? !aupat_match(ap, apc->fname, apc->sfname, apc->tail)
           : ap->buflocal_nr != apc->arg_bufnr) {
         continue;
       }
@@ -2301,7 +2375,7 @@ bool has_autocmd(event_T event, char *sfname, buf_T *buf)
     AutoPat *const ap = kv_A(*acs, i).pat;
     if (ap != NULL
         && (ap->buflocal_nr == 0
-            ? match_file_pat(NULL, &ap->reg_prog, fname, sfname, tail, ap->allow_dirs)
+            ? aupat_match(ap, fname, sfname, tail)
             : buf != NULL && ap->buflocal_nr == buf->b_fnum)) {
       retval = true;
       break;
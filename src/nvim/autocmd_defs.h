@@ -24,10 +24,22 @@ typedef struct {
   int save_prompt_insert;         ///< saved b_prompt_insert
 } aco_save_T;
 
+/// How an AutoPat is matched against a file name.
+typedef enum {
+  kAuPatRegex = 0,          ///< Match with "reg_prog"
+  kAuPatAny,                ///< "*": matches any name
+  kAuPatExact,              ///< "name": tail is equal to "lit"
+  kAuPatSuffix,             ///< "*.ext": tail ends in "lit"
+  kAuPatPrefix,             ///< "name*": tail starts with "lit"
+} AutoPatKind;
+
 typedef struct {
   size_t refcount;          ///< Reference count (freed when reaches zero)
   char *pat;                ///< Pattern as typed
   regprog_T *reg_prog;      ///< Compiled regprog for pattern
+  const char *lit;          ///< Literal part of "pat" for a literal "kind"
+  size_t litlen;            ///< Length of "lit"
+  AutoPatKind kind;         ///< How the pattern is matched
   int group;                ///< Group ID
   int patlen;               ///< strlen() of pat
   int buflocal_nr;          ///< !=0 for buffer-local AutoPat
@@ -5,6 +5,7 @@
 #include <stdio.h>
 
 #include "nvim/arglist_defs.h"
+#include "nvim/decoration_defs.h"
 #include "nvim/grid_defs.h"
 #include "nvim/mapping_defs.h"
 #include "nvim/marktree_defs.h"
@@ -348,11 +349,27 @@ typedef struct {
   LuaRef on_changedtick;
   LuaRef on_detach;
   LuaRef on_reload;
+  LuaRef on_changes;
   bool utf_sizes;
   bool preview;
+  size_t changes_skip;  ///< changes in "update_splices" from before attaching
 } BufUpdateCallbacks;
 #define BUF_UPDATE_CALLBACKS_INIT { LUA_NOREF, LUA_NOREF, LUA_NOREF, \
-                                    LUA_NOREF, LUA_NOREF, false, false }
+                                    LUA_NOREF, LUA_NOREF, LUA_NOREF, false, false, 0 }
+
+/// A change of the buffer text, with the arguments of "on_bytes".
+typedef struct {
+  int start_row;
+  colnr_T start_col;
+  bcount_t start_byte;
+  int old_row;
+  colnr_T old_col;
+  bcount_t old_byte;
+  int new_row;
+  colnr_T new_col;
+  bcount_t new_byte;
+} BufSplice;
+typedef kvec_t(BufSplice) BufSplices;
 
 #define BUF_HAS_QF_ENTRY 1
 #define BUF_HAS_LL_ENTRY 2
@@ -754,6 +771,15 @@ struct file_buffer {
   // whether an update callback has requested codepoint size of deleted regions.
   bool update_need_codepoints;
 
+  // Changes not yet passed to "on_changes" callbacks, a change which continues
+  // where the previous one ended is merged into it (from index
+  // "update_splices_merge"). When there are too many the changes are dropped
+  // and "update_splices_overflow" is set, the callbacks re-read the buffer.
+  BufSplices update_splices;
+  size_t update_splices_merge;
+  bool update_splices_overflow;
+  bool update_splices_scheduled;  // an event will pass the changes
+
   // Measurements of the deleted or replaced region since the last update
   // event. Some consumers of buffer changes need to know the byte size (like
   // treesitter) or the corresponding UTF-32/UTF-16 size (like LSP) of the
@@ -873,6 +899,44 @@ typedef struct {
   linenr_T wl_lastlnum;         // last buffer line number for logical line
 } wline_T;
 
+/// Fold level of a line computed from 'foldexpr', needed to continue
+/// computing fold levels at the next line.
+typedef struct {
+  int16_t lvl_next;  ///< level used for the next line, INT16_MIN if unknown
+  int16_t end;       ///< level of fold that is forced to end below this line
+} FoldExprLine;
+
+enum {
+  VCOL_CACHE_LINES = 4,  ///< number of lines in w_vcol_cache[]
+};
+
+/// Virtual column of a position in a long line, see vcol_cache_get().
+typedef struct {
+  colnr_T col;   ///< byte index of a character
+  colnr_T vcol;  ///< virtual column where that character starts
+} VcolCheckpoint;
+
+/// Virtual columns of one long line in a window, with a checkpoint every
+/// VCOL_CHECKPOINT_BYTES bytes.  Only used when the width of a character
+/// depends on nothing but its virtual column (CSType is kCharsizeFast).
+typedef struct {
+  handle_T buf;             ///< buffer of the line, 0 when the entry is unused
+  linenr_T lnum;
+  varnumber_T changedtick;  ///< b:changedtick of "buf" when computed
+  const char *line;         ///< line pointer when computed
+  colnr_T len;              ///< length of the line
+  unsigned generation;      ///< invalidated when character widths change
+  // Options the width of a character depends on.
+  OptInt ts;
+  bool use_tabstop;
+  bool border;              ///< 'wrap' is set and the window has a width
+  int width1;               ///< width of the first screen line when "border"
+  int width2;               ///< width of further screen lines when "border"
+
+  int width;                ///< width of the whole line
+  kvec_t(VcolCheckpoint) checkpoints;
+} VcolCacheLine;
+
 // Windows are kept in a tree of frames.  Each frame has a column (FR_COL)
 // or row (FR_ROW) layout or is a leaf, which has a window.
 struct frame_S {
@@ -1262,7 +1326,16 @@ struct window_S {
   wline_T *w_lines;
   int w_lines_size;
 
+  DecorCache w_decor_cache;         ///< decorations of the shown lines
+
+  VcolCacheLine w_vcol_cache[VCOL_CACHE_LINES];  ///< virtual columns of long lines
+  int w_vcol_cache_next;            ///< entry in w_vcol_cache[] to replace next
+
   garray_T w_folds;                 // array of nested folds
+  /// State of lines after evaluating 'foldexpr', indexed by line number
+  /// minus one, see foldexpr_line_set().
+  kvec_t(FoldExprLine) w_foldexpr_lines;
+  handle_T w_foldexpr_buf;          ///< buffer of w_foldexpr_lines
   bool w_fold_manual;               // when true: some folds are opened/closed
                                     // manually
   bool w_foldinvalid;               // when true: folding needs to be
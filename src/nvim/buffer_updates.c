@@ -11,9 +11,12 @@
 #include "nvim/buffer.h"
 #include "nvim/buffer_defs.h"
 #include "nvim/buffer_updates.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/multiqueue.h"
 #include "nvim/globals.h"
 #include "nvim/log.h"
 #include "nvim/lua/executor.h"
+#include "nvim/main.h"
 #include "nvim/memline.h"
 #include "nvim/memory.h"
 #include "nvim/memory_defs.h"
@@ -21,6 +24,10 @@
 #include "nvim/pos_defs.h"
 #include "nvim/types_defs.h"
 
+/// Max number of changes passed to "on_changes" at once, with more the
+/// callbacks re-read the buffer instead.
+enum { BUF_SPLICES_MAX = 1000 };
+
 #include "buffer_updates.c.generated.h"  // IWYU pragma: keep
 
 // Register a channel. Return True if the channel was added, or already added.
@@ -34,6 +41,11 @@ bool buf_updates_register(buf_T *buf, uint64_t channel_id, BufUpdateCallbacks cb
   }
 
   if (channel_id == LUA_INTERNAL_CALL) {
+    if (cb.on_changes != LUA_NOREF) {
+      // Changes made before attaching are not passed to the new callback.
+      cb.changes_skip = kv_size(buf->update_splices);
+      buf->update_splices_merge = kv_size(buf->update_splices);
+    }
     kv_push(buf->update_callbacks, cb);
     if (cb.utf_sizes) {
       buf->update_need_codepoints = true;
@@ -141,6 +153,7 @@ void buf_updates_unregister(buf_T *buf, uint64_t channelid)
 void buf_free_callbacks(buf_T *buf)
 {
   kv_destroy(buf->update_channels);
+  kv_destroy(buf->update_splices);
   for (size_t i = 0; i < kv_size(buf->update_callbacks); i++) {
     buffer_update_callbacks_free(kv_A(buf->update_callbacks, i));
   }
@@ -193,6 +206,8 @@ void buf_updates_unload(buf_T *buf, bool can_reload)
     kv_destroy(buf->update_callbacks);
     kv_init(buf->update_callbacks);
   }
+  // The callbacks kept re-read the buffer on reload.
+  buf_updates_clear_splices(buf);
 }
 
 void buf_updates_send_changes(buf_T *buf, linenr_T firstline, int64_t num_added,
@@ -319,10 +334,12 @@ void buf_updates_send_splice(buf_T *buf, int start_row, colnr_T start_col, bcoun
   }
 
   // notify each of the active callbacks
+  bool need_splice = false;
   size_t j = 0;
   for (size_t i = 0; i < kv_size(buf->update_callbacks); i++) {
     BufUpdateCallbacks cb = kv_A(buf->update_callbacks, i);
     bool keep = true;
+    need_splice |= cb.on_changes != LUA_NOREF;
     if (cb.on_bytes != LUA_NOREF && (cb.preview || !cmdpreview)) {
       MAXSIZE_TEMP_ARRAY(args, 11);
 
@@ -357,7 +374,132 @@ void buf_updates_send_splice(buf_T *buf, int start_row, colnr_T start_col, bcoun
     }
   }
   kv_size(buf->update_callbacks) = j;
+
+  if (need_splice && !cmdpreview) {
+    buf_updates_add_splice(buf, (BufSplice){ start_row, start_col, start_byte, old_row, old_col,
+                                             old_byte, new_row, new_col, new_byte });
+  }
+}
+
+/// Adds a change for the "on_changes" callbacks, which are called from the
+/// main loop with all changes made until then.
+static void buf_updates_add_splice(buf_T *buf, BufSplice splice)
+{
+  if (!buf->update_splices_scheduled) {
+    buf->update_splices_scheduled = true;
+    multiqueue_put(main_loop.events, buf_updates_changes_event,
+                   (void *)(ptrdiff_t)buf->handle);
+  }
+
+  if (buf->update_splices_overflow) {
+    return;
+  }
+
+  // A change starting where the previous one ended (typed text, a repeated
+  // command moving forward) replaces the text after the previous change.
+  if (kv_size(buf->update_splices) > buf->update_splices_merge) {
+    BufSplice *last = &kv_last(buf->update_splices);
+    if (splice.start_byte == last->start_byte + last->new_byte) {
+      last->old_col = splice.old_row > 0 ? splice.old_col : last->old_col + splice.old_col;
+      last->old_row += splice.old_row;
+      last->old_byte += splice.old_byte;
+      last->new_col = splice.new_row > 0 ? splice.new_col : last->new_col + splice.new_col;
+      last->new_row += splice.new_row;
+      last->new_byte += splice.new_byte;
+      return;
+    }
+  }
+
+  if (kv_size(buf->update_splices) >= BUF_SPLICES_MAX) {
+    buf->update_splices_overflow = true;
+    kv_destroy(buf->update_splices);
+    kv_init(buf->update_splices);
+    return;
+  }
+  kv_push(buf->update_splices, splice);
+}
+
+static void buf_updates_clear_splices(buf_T *buf)
+{
+  kv_size(buf->update_splices) = 0;
+  buf->update_splices_merge = 0;
+  buf->update_splices_overflow = false;
+}
+
+static void buf_updates_changes_event(void **argv)
+{
+  buf_T *buf = handle_get_buffer((handle_T)(ptrdiff_t)argv[0]);
+  if (buf == NULL) {
+    return;
+  }
+  buf->update_splices_scheduled = false;
+  buf_updates_send_splices(buf);
 }
+
+/// Calls the "on_changes" callbacks with the changes since they were last
+/// called, as a flat list of the "on_bytes" arguments of each change (nine
+/// integers per change), or nil if there were too many changes.
+static void buf_updates_send_splices(buf_T *buf)
+{
+  // The callbacks may cause new changes, they go into a new batch.
+  BufSplices splices = buf->update_splices;
+  bool overflow = buf->update_splices_overflow;
+  kv_init(buf->update_splices);
+  buf_updates_clear_splices(buf);
+  if (!overflow && kv_size(splices) == 0) {
+    return;
+  }
+
+  size_t j = 0;
+  for (size_t i = 0; i < kv_size(buf->update_callbacks); i++) {
+    BufUpdateCallbacks cb = kv_A(buf->update_callbacks, i);
+    bool keep = true;
+    size_t skip = cb.changes_skip;
+    kv_A(buf->update_callbacks, i).changes_skip = 0;
+    if (cb.on_changes != LUA_NOREF && (overflow || skip < kv_size(splices))) {
+      Arena arena = ARENA_EMPTY;
+      Object changes = NIL;
+      if (!overflow) {
+        Array list = arena_array(&arena, 9 * (kv_size(splices) - skip));
+        for (size_t k = skip; k < kv_size(splices); k++) {
+          BufSplice *sp = &kv_A(splices, k);
+          ADD_C(list, INTEGER_OBJ(sp->start_row));
+          ADD_C(list, INTEGER_OBJ(sp->start_col));
+          ADD_C(list, INTEGER_OBJ(sp->start_byte));
+          ADD_C(list, INTEGER_OBJ(sp->old_row));
+          ADD_C(list, INTEGER_OBJ(sp->old_col));
+          ADD_C(list, INTEGER_OBJ(sp->old_byte));
+          ADD_C(list, INTEGER_OBJ(sp->new_row));
+          ADD_C(list, INTEGER_OBJ(sp->new_col));
+          ADD_C(list, INTEGER_OBJ(sp->new_byte));
+        }
+        changes = ARRAY_OBJ(list);
+      }
+
+      MAXSIZE_TEMP_ARRAY(args, 3);
+      ADD_C(args, BUFFER_OBJ(buf->handle));
+      ADD_C(args, INTEGER_OBJ(buf_get_changedtick(buf)));
+      ADD_C(args, changes);
+
+      Object res;
+      TEXTLOCK_WRAP({
+        res = nlua_call_ref(cb.on_changes, "changes", args, kRetNilBool, NULL, NULL);
+      });
+      arena_mem_free(arena_finish(&arena));
+
+      if (LUARET_TRUTHY(res)) {
+        buffer_update_callbacks_free(cb);
+        keep = false;
+      }
+    }
+    if (keep) {
+      kv_A(buf->update_callbacks, j++) = kv_A(buf->update_callbacks, i);
+    }
+  }
+  kv_size(buf->update_callbacks) = j;
+  kv_destroy(splices);
+}
+
 void buf_updates_changedtick(buf_T *buf)
 {
   // notify each of the active channels
@@ -416,4 +558,5 @@ void buffer_update_callbacks_free(BufUpdateCallbacks cb)
   api_free_luaref(cb.on_changedtick);
   api_free_luaref(cb.on_reload);
   api_free_luaref(cb.on_detach);
+  api_free_luaref(cb.on_changes);
 }
@@ -26,6 +26,7 @@
 #include "nvim/memory.h"
 #include "nvim/option.h"
 #include "nvim/path.h"
+#include "nvim/plines.h"
 #include "nvim/pos_defs.h"
 #include "nvim/strings.h"
 #include "nvim/types_defs.h"
@@ -86,6 +87,9 @@ int init_chartab(void)
 /// an error, OK otherwise.
 int buf_init_chartab(buf_T *buf, bool global)
 {
+  // 'isprint' and 'display' change the width of characters.
+  vcol_cache_invalidate();
+
   if (global) {
     // Set the default size for printable characters:
     // From <Space> to '~' is 1 (printable), others are 2 (not printable).
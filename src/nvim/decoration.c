@@ -332,6 +332,7 @@ void decor_check_to_be_deleted(void)
   to_free_virt = NULL;
   to_free_sh = DECOR_ID_INVALID;
   decor_state.win = NULL;
+  decor_state.cache = NULL;
 }
 
 void decor_state_free(DecorState *state)
@@ -422,6 +423,7 @@ bool decor_redraw_reset(win_T *wp, DecorState *state)
 {
   state->row = -1;
   state->win = wp;
+  state->cache = NULL;
 
   int *const indices = state->ranges_i.items;
   DecorRangeSlot *const slots = state->slots.items;
@@ -466,11 +468,103 @@ VirtTextPos decor_virt_pos_kind(const DecorRange *decor)
   return kVPosEndOfLine;  // not used; return whatever
 }
 
+/// Collects the marks with decorations that can be drawn in rows "top_row" to
+/// "bot_row" (exclusive) of "wp" into its decoration cache.
+static void decor_cache_fill(win_T *wp, int top_row, int bot_row)
+{
+  buf_T *buf = wp->w_buffer;
+  MarkTree *tree = buf->b_marktree;
+  DecorCache *cache = &wp->w_decor_cache;
+  kv_size(cache->marks) = 0;
+  cache->overlap_count = 0;
+  cache->top_row = top_row;
+  cache->bot_row = bot_row;
+  cache->buf = buf;
+  cache->stamp = tree->stamp;
+  cache->valid = true;
+
+  MarkTreeIter itr[1];
+  if (!marktree_itr_get_overlap(tree, top_row, 0, itr)) {
+    return;
+  }
+  MTPair pair;
+  while (marktree_itr_step_overlap(tree, itr, &pair)) {
+    MTKey m = pair.start;
+    if (mt_invalid(m) || !mt_decor_any(m)) {
+      continue;
+    }
+    kv_push(cache->marks, ((DecorCacheMark){
+      .start_row = m.pos.row, .start_col = m.pos.col,
+      .end_row = pair.end_pos.row, .end_col = pair.end_pos.col,
+      .decor = mt_decor(m), .ns = m.ns, .id = m.id,
+    }));
+  }
+  cache->overlap_count = kv_size(cache->marks);
+
+  while (true) {
+    MTKey m = marktree_itr_current(itr);
+    if (m.pos.row < 0 || m.pos.row >= bot_row) {
+      break;
+    }
+    if (!mt_invalid(m) && !mt_end(m) && mt_decor_any(m)) {
+      MTPos endpos = marktree_get_altpos(tree, m, NULL);
+      kv_push(cache->marks, ((DecorCacheMark){
+        .start_row = m.pos.row, .start_col = m.pos.col,
+        .end_row = endpos.row, .end_col = endpos.col,
+        .decor = mt_decor(m), .ns = m.ns, .id = m.id,
+      }));
+    }
+    marktree_itr_next(tree, itr);
+  }
+}
+
+/// Starts drawing from "top_row" with the decoration cache of "wp", filling it
+/// first if the marks changed or "top_row" is outside it.  Rows outside the
+/// window are drawn from the marktree.
+///
+/// @return  false if the cache cannot be used.
+static bool decor_redraw_start_cached(win_T *wp, int top_row, DecorState *state)
+{
+  DecorCache *cache = &wp->w_decor_cache;
+  int win_top_row = wp->w_topline - 1;
+  int win_bot_row = MIN(wp->w_botline, wp->w_buffer->b_ml.ml_line_count + 1) - 1;
+  if (top_row < win_top_row || top_row >= win_bot_row) {
+    return false;
+  }
+  if (!cache->valid || cache->buf != wp->w_buffer || cache->stamp != wp->w_buffer->b_marktree->stamp
+      || cache->top_row != win_top_row || cache->bot_row != win_bot_row) {
+    decor_cache_fill(wp, win_top_row, win_bot_row);
+  }
+
+  // Add the ranges that start before "top_row" and end on or after it, like
+  // marktree_itr_step_overlap() would find them.
+  state->cache_idx = kv_size(cache->marks);
+  for (size_t i = 0; i < kv_size(cache->marks); i++) {
+    DecorCacheMark *m = &kv_A(cache->marks, i);
+    if (i >= cache->overlap_count && m->start_row >= top_row) {
+      state->cache_idx = i;
+      break;
+    }
+    if (m->end_row >= top_row) {
+      decor_range_add_from_inline(state, m->start_row, m->start_col, m->end_row, m->end_col,
+                                  m->decor, false, m->ns, m->id);
+    }
+  }
+  state->cache = cache;
+  return true;
+}
+
 bool decor_redraw_start(win_T *wp, int top_row, DecorState *state)
 {
   buf_T *buf = wp->w_buffer;
   state->top_row = top_row;
   state->itr_valid = true;
+  state->cache = NULL;
+  state->cache_idx = 0;
+
+  if (decor_redraw_start_cached(wp, top_row, state)) {
+    return true;
+  }
 
   if (!marktree_itr_get_overlap(buf->b_marktree, top_row, 0, state->itr)) {
     return false;
@@ -520,8 +614,10 @@ void decor_redraw_line(win_T *wp, int row, DecorState *state)
   if (state->row == -1) {
     decor_redraw_start(wp, row, state);
   } else if (!state->itr_valid) {
+    // Marks were changed while drawing, the cache is out of date too.
     marktree_itr_get(wp->w_buffer->b_marktree, row, 0, state->itr);
     state->itr_valid = true;
+    state->cache = NULL;
   }
 
   state->row = row;
@@ -536,6 +632,15 @@ bool decor_has_more_decorations(DecorState *state, int row)
     return true;
   }
 
+  if (state->cache) {
+    DecorCache *cache = state->cache;
+    if (state->cache_idx < kv_size(cache->marks)) {
+      return kv_A(cache->marks, state->cache_idx).start_row <= row;
+    }
+    // After the cached rows the marktree is used again.
+    return row >= cache->bot_row;
+  }
+
   MTKey k = marktree_itr_current(state->itr);
   return (k.pos.row >= 0 && k.pos.row <= row);
 }
@@ -694,7 +799,31 @@ int decor_redraw_col_impl(win_T *wp, int col, int win_col, bool hidden, DecorSta
   int const row = state->row;
   int col_until = MAXCOL;
 
-  while (true) {
+  DecorCache *const cache = state->cache;
+  while (cache) {
+    if (state->cache_idx == kv_size(cache->marks)) {
+      if (row >= cache->bot_row) {
+        // Continue with the marks after the cached rows.
+        marktree_itr_get(buf->b_marktree, cache->bot_row, 0, state->itr);
+        state->cache = NULL;
+      }
+      break;
+    }
+    DecorCacheMark *m = &kv_A(cache->marks, state->cache_idx);
+    if (m->start_row > row) {
+      break;
+    } else if (m->start_row == row && m->start_col > col) {
+      col_until = m->start_col - 1;
+      break;
+    }
+    if (ns_in_win(m->ns, wp)) {
+      decor_range_add_from_inline(state, m->start_row, m->start_col, m->end_row, m->end_col,
+                                  m->decor, false, m->ns, m->id);
+    }
+    state->cache_idx++;
+  }
+
+  while (state->cache == NULL) {
     // TODO(bfredl): check duplicate entry in "intersection"
     // branch
     MTKey mark = marktree_itr_current(state->itr);
@@ -1325,6 +1454,23 @@ uint16_t decor_type_flags(DecorInline decor)
   }
 }
 
+/// @return  whether "decor" highlights a range with highlight group "hl_id"
+bool decor_has_hl_id(DecorInline decor, int hl_id)
+{
+  if (!decor.ext) {
+    return !(decor.data.hl.flags & kSHIsSign) && decor.data.hl.hl_id == hl_id;
+  }
+  uint32_t idx = decor.data.ext.sh_idx;
+  while (idx != DECOR_ID_INVALID) {
+    DecorSignHighlight *sh = &kv_A(decor_items, idx);
+    if (!(sh->flags & kSHIsSign) && sh->hl_id == hl_id) {
+      return true;
+    }
+    idx = sh->next;
+  }
+  return false;
+}
+
 Object hl_group_name(int hl_id, bool hl_name)
 {
   if (hl_name) {
@@ -97,6 +97,9 @@ typedef struct {
 
   bool running_decor_provider;
   bool itr_valid;
+  /// When not NULL, marks are taken from this cache instead of "itr".
+  DecorCache *cache;
+  size_t cache_idx;  ///< next mark in "cache"
 } DecorState;
 
 EXTERN DecorState decor_state INIT( = { 0 });
@@ -168,3 +168,28 @@ typedef struct {
   { ns_id, kDecorProviderDisabled, 0, 0, LUA_NOREF, LUA_NOREF, \
     LUA_NOREF, LUA_NOREF, LUA_NOREF, LUA_NOREF, \
     LUA_NOREF, LUA_NOREF, -1, false, false, 0 }
+
+/// Extmark with decorations, as kept in DecorCache.
+typedef struct {
+  int start_row;
+  int start_col;
+  int end_row;
+  int end_col;
+  DecorInline decor;
+  uint32_t ns;
+  uint32_t id;
+} DecorCacheMark;
+
+/// The extmarks with decorations on the rows shown in a window, so that
+/// redrawing some of the rows does not search the marktree again.
+typedef struct {
+  /// Marks that start before "top_row" and end on or after it, then the marks
+  /// that start in rows "top_row" to "bot_row" (exclusive) in buffer order.
+  kvec_t(DecorCacheMark) marks;
+  size_t overlap_count;  ///< number of marks starting before "top_row"
+  int top_row;
+  int bot_row;
+  buf_T *buf;
+  uint64_t stamp;  ///< "stamp" of the marktree when the marks were collected
+  bool valid;
+} DecorCache;
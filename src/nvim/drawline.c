@@ -1494,6 +1494,12 @@ int win_line(win_T *wp, linenr_T lnum, int startrow, int endrow, int col_rows, b
     csarg.max_head_vcol = start_vcol;
     int vcol = wlv.vcol;
     StrCharInfo ci = utf_ptr2StrCharInfo(ptr);
+    if (cstype == kCharsizeFast && !wp->w_p_list && ptr == line && vcol == 0) {
+      // Skip most of a very long line without measuring every character.
+      VcolCheckpoint const cp = vcol_cache_find_vcol(&csarg, lnum, start_vcol);
+      ci = utf_ptr2StrCharInfo(line + cp.col);
+      vcol = cp.vcol;
+    }
     while (vcol < start_vcol) {
       cs = win_charsize(cstype, vcol, ci.ptr, ci.chr.value, &csarg);
       vcol += cs.width;
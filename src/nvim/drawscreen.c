@@ -644,6 +644,9 @@ int update_screen(void)
   }
 
   // Go from top to bottom through the windows, redrawing the ones that need it.
+  // This cannot be done in parallel: win_line() invokes decoration providers
+  // and evaluates 'statuscolumn', 'foldexpr' and the like, and uses the shared
+  // line buffers, the syntax state, the memline cache and decor_state.
   bool did_one = false;
   screen_search_hl.rm.regprog = NULL;
 
@@ -24,6 +24,7 @@
 #include "nvim/edit.h"
 #include "nvim/errors.h"
 #include "nvim/eval.h"
+#include "nvim/eval/ast.h"
 #include "nvim/eval/encode.h"
 #include "nvim/eval/executor.h"
 #include "nvim/eval/gc.h"
@@ -63,10 +64,12 @@
 #include "nvim/option_vars.h"
 #include "nvim/optionstr.h"
 #include "nvim/os/fs.h"
+#include "nvim/os/input.h"
 #include "nvim/os/lang.h"
 #include "nvim/os/os.h"
 #include "nvim/os/os_defs.h"
 #include "nvim/os/shell.h"
+#include "nvim/os/time.h"
 #include "nvim/path.h"
 #include "nvim/pos_defs.h"
 #include "nvim/profile.h"
@@ -222,6 +225,9 @@ void eval_clear(void)
 
   // functions not garbage collected
   free_all_functions();
+
+  // compiled expressions
+  eval_ast_cache_clear();
 }
 
 #endif
@@ -571,6 +577,9 @@ varnumber_T eval_to_number(char *expr, const bool use_simple_function)
 
   if (use_simple_function) {
     r = may_call_simple_func(expr, &rettv);
+    if (r == NOTDONE) {
+      r = eval_ast_cached(p, &rettv);
+    }
   }
   if (r == NOTDONE) {
     r = eval1(&p, &rettv, &EVALARG_EVALUATE);
@@ -1854,11 +1863,25 @@ int may_call_simple_func(const char *arg, typval_T *rettv)
 }
 
 /// Handle zero level expression with optimization for a simple function call.
+/// Other expressions are executed from their cached syntax tree when possible.
 /// Same arguments and return value as eval0().
 static int eval0_simple_funccal(char *arg, typval_T *rettv, exarg_T *eap, evalarg_T *const evalarg)
 {
   int r = may_call_simple_func(arg, rettv);
 
+  if (r == NOTDONE && eap == NULL && evalarg != NULL && evalarg->eval_flags == EVAL_EVALUATE
+      && evalarg->eval_getline == NULL) {
+    const int did_emsg_before = did_emsg;
+    const int called_emsg_before = called_emsg;
+
+    r = eval_ast_cached(skipwhite(arg), rettv);
+    // Same error as eval0() when no more specific error was given.
+    if (r == FAIL && !aborting()
+        && did_emsg == did_emsg_before
+        && called_emsg == called_emsg_before) {
+      semsg(_(e_invexpr2), arg);
+    }
+  }
   if (r == NOTDONE) {
     r = eval0(arg, rettv, eap, evalarg);
   }
@@ -2368,19 +2391,8 @@ static int eval5(char **arg, typval_T *rettv, evalarg_T *const evalarg)
     }
 
     const bool evaluate = evalarg == NULL ? 0 : (evalarg->eval_flags & EVAL_EVALUATE);
-    if ((op != '+' || (rettv->v_type != VAR_LIST && rettv->v_type != VAR_BLOB))
-        && (op == '.' || rettv->v_type != VAR_FLOAT) && evaluate) {
-      // For "list + ...", an illegal use of the first operand as
-      // a number cannot be determined before evaluating the 2nd
-      // operand: if this is also a list, all is ok.
-      // For "something . ...", "something - ..." or "non-list + ...",
-      // we know that the first operand needs to be a string or number
-      // without evaluating the 2nd operand.  So check before to avoid
-      // side effects after an error.
-      if ((op == '.' && !tv_check_str(rettv)) || (op != '.' && !tv_check_num(rettv))) {
-        tv_clear(rettv);
-        return FAIL;
-      }
+    if (evaluate && eval5_check_operand(rettv, op) == FAIL) {
+      return FAIL;
     }
 
     // Get the second variable.
@@ -2394,32 +2406,64 @@ static int eval5(char **arg, typval_T *rettv, evalarg_T *const evalarg)
       return FAIL;
     }
 
-    if (evaluate) {
-      // Compute the result.
-      if (op == '.') {
-        if (eval_concat_str(rettv, &var2) == FAIL) {
-          return FAIL;
-        }
-      } else if (op == '+' && rettv->v_type == VAR_BLOB && var2.v_type == VAR_BLOB) {
-        eval_addblob(rettv, &var2);
-      } else if (op == '+' && rettv->v_type == VAR_LIST && var2.v_type == VAR_LIST) {
-        if (eval_addlist(rettv, &var2) == FAIL) {
-          return FAIL;
-        }
-      } else {
-        if (eval_addsub_number(rettv, &var2, op) == FAIL) {
-          return FAIL;
-        }
-      }
-      tv_clear(&var2);
+    if (evaluate && eval5_operator(rettv, &var2, op) == FAIL) {
+      return FAIL;
+    }
+  }
+  return OK;
+}
+
+/// Check the first operand "tv1" of "op" ('+', '-' or '.') before the second
+/// operand is evaluated.  Clears "tv1" when it cannot be used.
+///
+/// @return  OK or FAIL.
+int eval5_check_operand(typval_T *tv1, int op)
+{
+  if ((op != '+' || (tv1->v_type != VAR_LIST && tv1->v_type != VAR_BLOB))
+      && (op == '.' || tv1->v_type != VAR_FLOAT)) {
+    // For "list + ...", an illegal use of the first operand as
+    // a number cannot be determined before evaluating the 2nd
+    // operand: if this is also a list, all is ok.
+    // For "something . ...", "something - ..." or "non-list + ...",
+    // we know that the first operand needs to be a string or number
+    // without evaluating the 2nd operand.  So check before to avoid
+    // side effects after an error.
+    if ((op == '.' && !tv_check_str(tv1)) || (op != '.' && !tv_check_num(tv1))) {
+      tv_clear(tv1);
+      return FAIL;
+    }
+  }
+  return OK;
+}
+
+/// Compute "tv1 op tv2" for '+', '-' and '.' and store the result in "tv1".
+/// "tv2" is cleared.
+///
+/// @return  OK or FAIL.
+int eval5_operator(typval_T *tv1, typval_T *tv2, int op)
+{
+  if (op == '.') {
+    if (eval_concat_str(tv1, tv2) == FAIL) {
+      return FAIL;
+    }
+  } else if (op == '+' && tv1->v_type == VAR_BLOB && tv2->v_type == VAR_BLOB) {
+    eval_addblob(tv1, tv2);
+  } else if (op == '+' && tv1->v_type == VAR_LIST && tv2->v_type == VAR_LIST) {
+    if (eval_addlist(tv1, tv2) == FAIL) {
+      return FAIL;
+    }
+  } else {
+    if (eval_addsub_number(tv1, tv2, op) == FAIL) {
+      return FAIL;
     }
   }
+  tv_clear(tv2);
   return OK;
 }
 
 /// Multiply or divide or compute the modulo of numbers "tv1" and "tv2" and
 /// store the result in "tv1".  The numbers can be whole numbers or floats.
-static int eval_multdiv_number(typval_T *tv1, typval_T *tv2, int op)
+int eval_multdiv_number(typval_T *tv1, typval_T *tv2, int op)
   FUNC_ATTR_NO_SANITIZE_UNDEFINED
 {
   varnumber_T n1, n2;
@@ -2757,8 +2801,8 @@ static int eval7(char **arg, typval_T *rettv, evalarg_T *const evalarg, bool wan
 /// @param numeric_only  if true only handle "+" and "-".
 ///
 /// @return  OK on success, FAIL on failure.
-static int eval7_leader(typval_T *const rettv, const bool numeric_only,
-                        const char *const start_leader, const char **const end_leaderp)
+int eval7_leader(typval_T *const rettv, const bool numeric_only, const char *const start_leader,
+                 const char **const end_leaderp)
   FUNC_ATTR_NONNULL_ALL
 {
   const char *end_leader = *end_leaderp;
@@ -3812,6 +3856,8 @@ void partial_unref(partial_T *pt)
 
   if (--pt->pt_refcount <= 0) {
     partial_free(pt);
+  } else {
+    gc_refs_dropped = true;
   }
 }
 
@@ -3952,6 +3998,48 @@ int get_copyID(void)
 /// but it applies to all reference-counting mechanisms):
 ///      http://python.ca/nas/python/gc/
 
+/// Number of items marked between checks for pending input.
+#define GC_YIELD_ITEMS 10000
+/// Number of interrupted idle collections after which the next one runs to
+/// completion, so that typing continuously cannot postpone it forever.
+#define GC_MAX_INTERRUPTED 3
+
+/// Statistics about garbage collection pauses, see gcstats().
+static struct {
+  int count;          ///< Number of completed collections.
+  int interrupted;    ///< Number of collections interrupted by typeahead.
+  int skipped;        ///< Number of idle collections skipped.
+  uint64_t last;      ///< Duration of the last collection in nanoseconds.
+  uint64_t max;       ///< Longest collection in nanoseconds.
+  uint64_t total;     ///< Total time spent collecting in nanoseconds.
+} gc_stats = { 0 };
+
+static bool gc_interruptible = false;  ///< Marking may be interrupted by input.
+static bool gc_interrupted = false;    ///< Marking was interrupted by input.
+static int gc_yield_count = 0;
+static int gc_interrupted_in_row = 0;
+
+/// Check for pending input every GC_YIELD_ITEMS marked items when the current
+/// collection is interruptible.
+///
+/// @return  true if marking should be abandoned.
+static bool gc_yield(void)
+{
+  if (!gc_interruptible) {
+    return false;
+  }
+  if (gc_interrupted) {
+    return true;
+  }
+  if (++gc_yield_count >= GC_YIELD_ITEMS) {
+    gc_yield_count = 0;
+    // Do not process events here: they may create or move containers that
+    // would not be marked and then be freed.  Stop when any are waiting.
+    gc_interrupted = os_input_ready(main_loop.fast_events) || loop_io_pending(&main_loop);
+  }
+  return gc_interrupted;
+}
+
 /// Do garbage collection for lists and dicts.
 ///
 /// @param testing  true if called from test_garbagecollect_now().
@@ -3962,6 +4050,10 @@ bool garbage_collect(bool testing)
   bool abort = false;
 #define ABORTING(func) abort = abort || func
 
+  const uint64_t start = os_hrtime();
+  gc_interrupted = false;
+  gc_yield_count = 0;
+
   if (!testing) {
     // Only do this once.
     want_garbage_collect = false;
@@ -4103,20 +4195,57 @@ bool garbage_collect(bool testing)
   ABORTING(set_ref_in_quickfix)(copyID);
 
   bool did_free = false;
-  if (!abort) {
+  const bool interrupted = gc_interrupted;
+  if (!abort && !interrupted) {
+    // No reference cycle can become unreachable until a reference is dropped
+    // again.
+    gc_refs_dropped = false;
+
     // 2. Free lists and dictionaries that are not referenced.
     did_free = free_unref_items(copyID);
 
     // 3. Check if any funccal can be freed now.
     //    This may call us back recursively.
     did_free = free_unref_funccal(copyID, testing) || did_free;
-  } else if (p_verbose > 0) {
+  } else if (p_verbose > 0 && !interrupted) {
     verb_msg(_("Not enough memory to set references, garbage collection aborted!"));
   }
 #undef ABORTING
+
+  const uint64_t elapsed = os_hrtime() - start;
+  if (interrupted) {
+    gc_stats.interrupted++;
+  } else {
+    gc_stats.count++;
+  }
+  gc_stats.last = elapsed;
+  gc_stats.max = MAX(gc_stats.max, elapsed);
+  gc_stats.total += elapsed;
   return did_free;
 }
 
+/// Do garbage collection while waiting for the user to type a character.
+///
+/// The collection is skipped when no reference was dropped since the last one,
+/// as nothing can have become unreachable then.  Otherwise marking is
+/// abandoned as soon as typeahead arrives, unless that already happened
+/// GC_MAX_INTERRUPTED times in a row or garbagecollect() asked for it.
+void garbage_collect_idle(void)
+{
+  if (!want_garbage_collect && !gc_refs_dropped) {
+    may_garbage_collect = false;
+    gc_stats.skipped++;
+    return;
+  }
+
+  gc_interruptible = !want_garbage_collect && gc_interrupted_in_row < GC_MAX_INTERRUPTED;
+  garbage_collect(false);
+  gc_interruptible = false;
+  // After an interrupted collection "gc_refs_dropped" is still set, so the
+  // next idle collection tries again.
+  gc_interrupted_in_row = gc_interrupted ? gc_interrupted_in_row + 1 : 0;
+}
+
 /// Free lists and dictionaries that are no longer referenced.
 ///
 /// @note  This function may only be called from garbage_collect().
@@ -4359,6 +4488,10 @@ bool set_ref_in_item(typval_T *tv, int copyID, ht_stack_T **ht_stack, list_stack
 {
   bool abort = false;
 
+  if (gc_yield()) {
+    return true;
+  }
+
   switch (tv->v_type) {
   case VAR_DICT:
     return set_ref_in_item_dict(tv->vval.v_dict, copyID, ht_stack, list_stack);
@@ -4776,6 +4909,19 @@ static void get_system_output_as_rettv(typval_T *argvars, typval_T *rettv, bool
   }
 }
 
+/// "gcstats()" function
+void f_gcstats(typval_T *argvars, typval_T *rettv, EvalFuncData fptr)
+{
+  tv_dict_alloc_ret(rettv);
+  dict_T *d = rettv->vval.v_dict;
+  tv_dict_add_nr(d, S_LEN("count"), gc_stats.count);
+  tv_dict_add_nr(d, S_LEN("interrupted"), gc_stats.interrupted);
+  tv_dict_add_nr(d, S_LEN("skipped"), gc_stats.skipped);
+  tv_dict_add_float(d, S_LEN("last"), (double)gc_stats.last / 1000000.0);
+  tv_dict_add_float(d, S_LEN("max"), (double)gc_stats.max / 1000000.0);
+  tv_dict_add_float(d, S_LEN("total"), (double)gc_stats.total / 1000000.0);
+}
+
 /// f_system - the Vimscript system() function
 void f_system(typval_T *argvars, typval_T *rettv, EvalFuncData fptr)
 {
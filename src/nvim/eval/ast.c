@@ -0,0 +1,597 @@
+// Executor for expressions compiled from the syntax tree of the expression
+// parser.
+//
+// Expressions in options like 'foldexpr' and 'indentexpr' are evaluated many
+// times with the same text.  Instead of going over the text with eval1() every
+// time, the expression is parsed once with viml_pexpr_parse() and converted to
+// a tree of exprnode_T, which is kept in a cache keyed by the expression text
+// and executed directly.  Only a subset of expressions is compiled: anything
+// with a construct not handled here is remembered as such and left to eval0().
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "nvim/ascii_defs.h"
+#include "nvim/eval.h"
+#include "nvim/eval/ast.h"
+#include "nvim/eval/typval.h"
+#include "nvim/eval/typval_defs.h"
+#include "nvim/eval/userfunc.h"
+#include "nvim/eval/vars.h"
+#include "nvim/ex_eval.h"
+#include "nvim/gettext_defs.h"
+#include "nvim/globals.h"
+#include "nvim/hashtab.h"
+#include "nvim/macros_defs.h"
+#include "nvim/memory.h"
+#include "nvim/option_vars.h"
+#include "nvim/strings.h"
+#include "nvim/types_defs.h"
+#include "nvim/vim_defs.h"
+#include "nvim/viml/parser/expressions.h"
+#include "nvim/viml/parser/parser.h"
+#include "nvim/viml/parser/parser_defs.h"
+
+/// Maximum number of cached expressions.  The cache is emptied when full.
+#define EXPR_CACHE_SIZE 64
+
+/// Maximum nesting depth of a compiled expression.
+#define EXPR_MAX_DEPTH 100
+
+typedef struct exprnode_S exprnode_T;
+
+/// Node of a compiled expression.
+struct exprnode_S {
+  ExprASTNodeType type;  ///< Node type, as produced by the parser.
+  exprnode_T *children;  ///< Operands, or arguments of a function call.
+  exprnode_T *next;      ///< Next operand or argument.
+  union {
+    typval_T tv;  ///< Constant value: numbers and strings.
+    struct {
+      char *name;  ///< Allocated name, with "&" for an option.
+      int len;     ///< Length of "name".
+    } name;  ///< Variable, option or function name.
+    struct {
+      exprtype_T type;
+      ExprCaseCompareStrategy ccs;
+    } cmp;  ///< For kExprNodeComparison.
+  } data;
+};
+
+/// Cached expression, "key" is the expression text.
+typedef struct {
+  exprnode_T *root;  ///< NULL if the expression could not be compiled.
+  char key[];
+} exprcache_T;
+
+#define HI2EC(hi) ((exprcache_T *)((hi)->hi_key - offsetof(exprcache_T, key)))
+
+/// Cache of compiled expressions.
+static hashtab_T expr_cache;
+
+/// Nesting of expressions being executed.  Nodes must not be freed while
+/// this is non-zero.
+static int expr_exec_depth = 0;
+
+#include "eval/ast.c.generated.h"
+
+/// Evaluate expression "expr" from its cached syntax tree.  "expr" must not
+/// start with white space.
+///
+/// @return  OK or FAIL, NOTDONE if the expression cannot be compiled and
+///          has to be evaluated with eval0() or eval1().
+int eval_ast_cached(const char *expr, typval_T *rettv)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (expr_cache.ht_mask == 0) {
+    hash_init(&expr_cache);
+  }
+
+  exprcache_T *ec;
+  hashitem_T *hi = hash_find(&expr_cache, expr);
+  if (!HASHITEM_EMPTY(hi)) {
+    ec = HI2EC(hi);
+  } else {
+    if (expr_cache.ht_used >= EXPR_CACHE_SIZE) {
+      if (expr_exec_depth > 0) {
+        return NOTDONE;
+      }
+      eval_ast_cache_clear();
+    }
+    const size_t len = strlen(expr);
+    ec = xmalloc(offsetof(exprcache_T, key) + len + 1);
+    memcpy(ec->key, expr, len + 1);
+    ec->root = expr_compile(ec->key, len);
+    hash_add(&expr_cache, ec->key);
+  }
+
+  if (ec->root == NULL) {
+    return NOTDONE;
+  }
+
+  CLEAR_POINTER(rettv);
+  expr_exec_depth++;
+  const int ret = expr_exec(ec->root, rettv);
+  expr_exec_depth--;
+  return ret;
+}
+
+/// Free all compiled expressions.
+void eval_ast_cache_clear(void)
+{
+  if (expr_cache.ht_mask == 0) {
+    return;
+  }
+  HASHTAB_ITER(&expr_cache, hi, {
+    expr_free_node(HI2EC(hi)->root);
+  });
+  hash_clear_all(&expr_cache, offsetof(exprcache_T, key));
+  hash_init(&expr_cache);
+}
+
+/// Check for text the expression parser handles differently from eval0():
+/// a NL or a single "|" ends the expression for eval0().
+static bool expr_may_compile(const char *expr)
+{
+  for (const char *p = expr; *p != NUL; p++) {
+    if (*p == NL || *p == CAR) {
+      return false;
+    }
+    if (*p == '|') {
+      if (p[1] != '|') {
+        return false;
+      }
+      p++;
+    }
+  }
+  return true;
+}
+
+/// Parse "expr" and compile it.
+///
+/// @return  the root of the compiled expression or NULL.
+static exprnode_T *expr_compile(const char *expr, size_t len)
+{
+  if (!expr_may_compile(expr)) {
+    return NULL;
+  }
+
+  ParserLine parser_lines[] = {
+    {
+      .data = expr,
+      .size = len,
+      .allocated = false,
+    },
+    { NULL, 0, false },
+  };
+  ParserLine *plines_p = parser_lines;
+  ParserState pstate;
+  viml_parser_init(&pstate, parser_simple_get_line, &plines_p, NULL);
+  ExprAST east = viml_pexpr_parse(&pstate, kExprFlagsDisallowEOC);
+
+  exprnode_T *root = NULL;
+  if (east.err.msg == NULL && (pstate.pos.line == 1 || pstate.pos.col == len)) {
+    // Constants are evaluated here, a failure only means the expression is
+    // left to eval0(), which gives the error.
+    emsg_off++;
+    root = expr_compile_node(expr, east.root, 0, false);
+    emsg_off--;
+  }
+
+  viml_pexpr_free_ast(east);
+  viml_parser_destroy(&pstate);
+  return root;
+}
+
+/// Get an allocated copy of the text of "ast" in "expr", without leading
+/// white space.
+static char *expr_node_text(const char *expr, const ExprASTNode *ast, int *lenp)
+{
+  const char *s = expr + ast->start.col;
+  const char *const e = s + ast->len;
+  while (s < e && ascii_iswhite(*s)) {
+    s++;
+  }
+  *lenp = (int)(e - s);
+  return xmemdupz(s, (size_t)(e - s));
+}
+
+/// Check that "name" would be taken as a whole as a variable or function
+/// name by eval7().
+static bool expr_valid_name(const char *name, int len)
+{
+  const char *p = name;
+  char *alias;
+  const int name_len = get_name_len(&p, &alias, false, false);
+  xfree(alias);
+  return len > 0 && name_len == len && *p == NUL && vim_strchr(name, '{') == NULL;
+}
+
+/// Compile node "ast" of an expression parsed from "expr".
+///
+/// @param concat_rhs  "ast" starts the operand after ".", where eval7() does
+///                    not recognize a Float.
+///
+/// @return  the compiled node or NULL if "ast" cannot be compiled.
+static exprnode_T *expr_compile_node(const char *expr, const ExprASTNode *ast, int depth,
+                                     bool concat_rhs)
+{
+  if (ast == NULL || depth > EXPR_MAX_DEPTH) {
+    return NULL;
+  }
+
+  exprnode_T *node = xcalloc(1, sizeof(*node));
+  node->type = ast->type;
+  bool ok = false;
+
+  switch (ast->type) {
+  case kExprNodeFloat:
+    if (concat_rhs) {
+      break;
+    }
+    FALLTHROUGH;
+  case kExprNodeInteger:
+  case kExprNodeSingleQuotedString:
+  case kExprNodeDoubleQuotedString: {
+    // Let eval1() take care of number and string syntax, the result is
+    // stored as a constant.
+    int len;
+    char *text = expr_node_text(expr, ast, &len);
+    char *p = text;
+    if (eval1(&p, &node->data.tv, &EVALARG_EVALUATE) == OK) {
+      ok = *p == NUL && (node->data.tv.v_type == VAR_NUMBER
+                         || node->data.tv.v_type == VAR_FLOAT
+                         || node->data.tv.v_type == VAR_STRING);
+    }
+    xfree(text);
+    break;
+  }
+
+  case kExprNodeOption: {
+    node->data.name.name = expr_node_text(expr, ast, &node->data.name.len);
+    const char *p = node->data.name.name;
+    typval_T tv;
+    ok = eval_option(&p, &tv, false) == OK && *p == NUL;
+    break;
+  }
+
+  case kExprNodePlainIdentifier:
+    node->data.name.name = expr_node_text(expr, ast, &node->data.name.len);
+    ok = expr_valid_name(node->data.name.name, node->data.name.len);
+    break;
+
+  case kExprNodeCall: {
+    const ExprASTNode *const callee = ast->children;
+    if (callee->type != kExprNodePlainIdentifier) {
+      break;
+    }
+    node->data.name.name = expr_node_text(expr, callee, &node->data.name.len);
+    if (!expr_valid_name(node->data.name.name, node->data.name.len)) {
+      break;
+    }
+    // Arguments are chained with right-nested kExprNodeComma nodes.
+    ok = true;
+    int argc = 0;
+    exprnode_T **argp = &node->children;
+    for (const ExprASTNode *arg = callee->next; arg != NULL && ok;) {
+      const ExprASTNode *next = NULL;
+      if (arg->type == kExprNodeComma) {
+        next = arg->children->next;
+        arg = arg->children;
+      }
+      *argp = expr_compile_node(expr, arg, depth + 1, false);
+      ok = *argp != NULL && ++argc <= MAX_FUNC_ARGS;
+      if (*argp != NULL) {
+        argp = &(*argp)->next;
+      }
+      arg = next;
+    }
+    break;
+  }
+
+  case kExprNodeNested:
+    node->children = expr_compile_node(expr, ast->children, depth + 1, false);
+    ok = node->children != NULL;
+    break;
+
+  case kExprNodeNot:
+  case kExprNodeUnaryMinus:
+  case kExprNodeUnaryPlus:
+    node->children = expr_compile_node(expr, ast->children, depth + 1, concat_rhs);
+    ok = node->children != NULL;
+    break;
+
+  case kExprNodeComparison:
+    if (ast->children->type == kExprNodeComparison
+        || ast->children->next->type == kExprNodeComparison) {
+      // "a == b == c" is an error for eval4().
+      break;
+    }
+    switch (ast->data.cmp.type) {
+    case kExprCmpEqual:
+      node->data.cmp.type = ast->data.cmp.inv ? EXPR_NEQUAL : EXPR_EQUAL;
+      break;
+    case kExprCmpMatches:
+      node->data.cmp.type = ast->data.cmp.inv ? EXPR_NOMATCH : EXPR_MATCH;
+      break;
+    case kExprCmpGreater:
+      node->data.cmp.type = ast->data.cmp.inv ? EXPR_SEQUAL : EXPR_GREATER;
+      break;
+    case kExprCmpGreaterOrEqual:
+      node->data.cmp.type = ast->data.cmp.inv ? EXPR_SMALLER : EXPR_GEQUAL;
+      break;
+    case kExprCmpIdentical:
+      node->data.cmp.type = ast->data.cmp.inv ? EXPR_ISNOT : EXPR_IS;
+      break;
+    }
+    node->data.cmp.ccs = ast->data.cmp.ccs;
+    FALLTHROUGH;
+  case kExprNodeOr:
+  case kExprNodeAnd:
+  case kExprNodeBinaryPlus:
+  case kExprNodeBinaryMinus:
+  case kExprNodeConcat:
+  case kExprNodeMultiplication:
+  case kExprNodeDivision:
+  case kExprNodeMod: {
+    exprnode_T *const lhs = expr_compile_node(expr, ast->children, depth + 1, concat_rhs);
+    node->children = lhs;
+    if (lhs != NULL) {
+      lhs->next = expr_compile_node(expr, ast->children->next, depth + 1,
+                                    ast->type == kExprNodeConcat);
+      ok = lhs->next != NULL;
+    }
+    break;
+  }
+
+  case kExprNodeTernary: {
+    const ExprASTNode *const value = ast->children->next;
+    if (value == NULL || value->type != kExprNodeTernaryValue || !value->data.ter.got_colon) {
+      break;
+    }
+    exprnode_T *const cond = expr_compile_node(expr, ast->children, depth + 1, false);
+    node->children = cond;
+    if (cond != NULL) {
+      cond->next = expr_compile_node(expr, value->children, depth + 1, false);
+      if (cond->next != NULL) {
+        cond->next->next = expr_compile_node(expr, value->children->next, depth + 1, false);
+        ok = cond->next->next != NULL;
+      }
+    }
+    break;
+  }
+
+  default:
+    // Lists, dictionaries, lambdas, subscripts, registers, environment
+    // variables, etc.: left to eval0().
+    break;
+  }
+
+  if (!ok) {
+    expr_free_node(node);
+    return NULL;
+  }
+  return node;
+}
+
+/// Free compiled node "node", its children and following nodes.
+static void expr_free_node(exprnode_T *node)
+{
+  while (node != NULL) {
+    exprnode_T *const next = node->next;
+    expr_free_node(node->children);
+    switch (node->type) {
+    case kExprNodeInteger:
+    case kExprNodeFloat:
+    case kExprNodeSingleQuotedString:
+    case kExprNodeDoubleQuotedString:
+      tv_clear(&node->data.tv);
+      break;
+    case kExprNodeOption:
+    case kExprNodePlainIdentifier:
+    case kExprNodeCall:
+      xfree(node->data.name.name);
+      break;
+    default:
+      break;
+    }
+    xfree(node);
+    node = next;
+  }
+}
+
+/// Execute compiled node "node" and put the result in "rettv".
+/// Mirrors what eval1() and friends do for the same expression.
+///
+/// @return  OK or FAIL.
+static int expr_exec(const exprnode_T *node, typval_T *rettv)
+{
+  const exprnode_T *const lhs = node->children;
+  int ret = OK;
+
+  switch (node->type) {
+  case kExprNodeInteger:
+  case kExprNodeFloat:
+  case kExprNodeSingleQuotedString:
+  case kExprNodeDoubleQuotedString:
+    tv_copy(&node->data.tv, rettv);
+    return OK;
+
+  case kExprNodeOption: {
+    const char *p = node->data.name.name;
+    return eval_option(&p, rettv, true);
+  }
+
+  case kExprNodePlainIdentifier:
+    return eval_variable(node->data.name.name, node->data.name.len, rettv, NULL, true, false);
+
+  case kExprNodeCall:
+    return expr_exec_call(node, rettv);
+
+  case kExprNodeNested:
+    return expr_exec(lhs, rettv);
+
+  case kExprNodeNot:
+  case kExprNodeUnaryMinus:
+  case kExprNodeUnaryPlus: {
+    if (expr_exec(lhs, rettv) == FAIL) {
+      return FAIL;
+    }
+    const char *const leader = (node->type == kExprNodeNot
+                                ? "!"
+                                : node->type == kExprNodeUnaryMinus ? "-" : "+");
+    const char *end_leader = leader + 1;
+    return eval7_leader(rettv, false, leader, &end_leader);
+  }
+
+  case kExprNodeOr:
+  case kExprNodeAnd: {
+    // Like eval2() and eval3(): the result is a Number.
+    const bool is_or = node->type == kExprNodeOr;
+    if (expr_exec(lhs, rettv) == FAIL) {
+      return FAIL;
+    }
+    bool error = false;
+    bool result = tv_get_number_chk(rettv, &error) != 0;
+    tv_clear(rettv);
+    if (error) {
+      return FAIL;
+    }
+    if (result != is_or) {
+      typval_T var2;
+      if (expr_exec(lhs->next, &var2) == FAIL) {
+        return FAIL;
+      }
+      result = tv_get_number_chk(&var2, &error) != 0;
+      tv_clear(&var2);
+      if (error) {
+        return FAIL;
+      }
+    }
+    rettv->v_type = VAR_NUMBER;
+    rettv->vval.v_number = result;
+    return OK;
+  }
+
+  case kExprNodeTernary: {
+    if (expr_exec(lhs, rettv) == FAIL) {
+      return FAIL;
+    }
+    bool error = false;
+    const bool result = tv_get_number_chk(rettv, &error) != 0;
+    tv_clear(rettv);
+    if (error) {
+      return FAIL;
+    }
+    return expr_exec(result ? lhs->next : lhs->next->next, rettv);
+  }
+
+  default:
+    break;
+  }
+
+  // Binary operators.
+  if (expr_exec(lhs, rettv) == FAIL) {
+    return FAIL;
+  }
+
+  int op = NUL;
+  switch (node->type) {
+  case kExprNodeBinaryPlus:
+    op = '+';
+    break;
+  case kExprNodeBinaryMinus:
+    op = '-';
+    break;
+  case kExprNodeConcat:
+    op = '.';
+    break;
+  case kExprNodeMultiplication:
+    op = '*';
+    break;
+  case kExprNodeDivision:
+    op = '/';
+    break;
+  case kExprNodeMod:
+    op = '%';
+    break;
+  default:
+    break;
+  }
+
+  if ((op == '+' || op == '-' || op == '.') && eval5_check_operand(rettv, op) == FAIL) {
+    return FAIL;
+  }
+
+  typval_T var2;
+  if (expr_exec(lhs->next, &var2) == FAIL) {
+    tv_clear(rettv);
+    return FAIL;
+  }
+
+  if (node->type == kExprNodeComparison) {
+    const bool ic = (node->data.cmp.ccs == kCCStrategyUseOption
+                     ? p_ic
+                     : node->data.cmp.ccs == kCCStrategyIgnoreCase);
+    ret = typval_compare(rettv, &var2, node->data.cmp.type, ic);
+    tv_clear(&var2);
+  } else if (op == '*' || op == '/' || op == '%') {
+    ret = eval_multdiv_number(rettv, &var2, op);
+  } else {
+    ret = eval5_operator(rettv, &var2, op);
+  }
+  return ret;
+}
+
+/// Execute a function call, like eval_func() does for "name(arg, ...)".
+static int expr_exec_call(const exprnode_T *node, typval_T *rettv)
+{
+  int len = node->data.name.len;
+  partial_T *partial;
+  bool found_var = false;
+  char *s = deref_func_name(node->data.name.name, &len, &partial, false, &found_var);
+
+  // Need to make a copy, in case evaluating the arguments makes
+  // the name invalid.
+  s = xmemdupz(s, (size_t)len);
+
+  typval_T argvars[MAX_FUNC_ARGS + 1];
+  int argcount = 0;
+  int ret = OK;
+  const int max_args = MAX_FUNC_ARGS - (partial == NULL ? 0 : partial->pt_argc);
+  for (const exprnode_T *arg = node->children; arg != NULL; arg = arg->next) {
+    if (argcount >= max_args || expr_exec(arg, &argvars[argcount]) == FAIL) {
+      ret = FAIL;
+      break;
+    }
+    argcount++;
+  }
+
+  if (ret == OK) {
+    funcexe_T funcexe = FUNCEXE_INIT;
+    funcexe.fe_firstline = curwin->w_cursor.lnum;
+    funcexe.fe_lastline = curwin->w_cursor.lnum;
+    funcexe.fe_evaluate = true;
+    funcexe.fe_partial = partial;
+    funcexe.fe_found_var = found_var;
+    ret = call_func_argvars(s, len, rettv, argcount, argvars, &funcexe);
+  } else if (!aborting()) {
+    emsg_funcname(N_("E116: Invalid arguments for function %s"), s);
+  }
+
+  while (--argcount >= 0) {
+    tv_clear(&argvars[argcount]);
+  }
+  xfree(s);
+
+  // Stop the expression evaluation when immediately aborting on error, or
+  // when an interrupt occurred or an exception was thrown but not caught.
+  if (aborting()) {
+    if (ret == OK) {
+      tv_clear(rettv);
+    }
+    ret = FAIL;
+  }
+  return ret;
+}
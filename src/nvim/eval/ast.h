@@ -0,0 +1,5 @@
+#pragma once
+
+#include "nvim/eval/typval_defs.h"  // IWYU pragma: keep
+
+#include "eval/ast.h.generated.h"
@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stddef.h>
 
 #include "nvim/eval/gc.h"
@@ -8,3 +9,6 @@
 dict_T *gc_first_dict = NULL;
 /// Head of list of all lists
 list_T *gc_first_list = NULL;
+/// Set when a reference to a list, dict, partial or function was dropped
+/// without freeing it, which may have left a reference cycle unreachable.
+bool gc_refs_dropped = false;
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "nvim/eval/typval_defs.h"
 
 extern dict_T *gc_first_dict;
 extern list_T *gc_first_list;
+extern bool gc_refs_dropped;
 
 #include "eval/gc.h.generated.h"
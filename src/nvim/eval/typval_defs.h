@@ -329,6 +329,8 @@ struct ufunc_S {
   garray_T uf_args;          ///< arguments, including optional arguments
   garray_T uf_def_args;      ///< default argument expressions
   garray_T uf_lines;         ///< function lines
+  bool *uf_skip_lines;       ///< for each line in uf_lines: comment or empty
+                             ///< lines that need not be executed, or NULL
   int uf_profiling;     ///< true when func is being profiled
   int uf_prof_initialized;
   LuaRef uf_luaref;      ///< lua callback, used if (uf_flags & FC_LUAREF)
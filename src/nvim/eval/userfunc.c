@@ -20,6 +20,7 @@
 #include "nvim/eval.h"
 #include "nvim/eval/encode.h"
 #include "nvim/eval/funcs.h"
+#include "nvim/eval/gc.h"
 #include "nvim/eval/typval.h"
 #include "nvim/eval/userfunc.h"
 #include "nvim/eval/vars.h"
@@ -564,22 +565,7 @@ int get_func_tv(const char *name, int len, typval_T *rettv, char **arg, evalarg_
 
   assert(ret == OK || ret == FAIL);  // suppress clang false positive
   if (ret == OK) {
-    int i = 0;
-
-    if (get_vim_var_nr(VV_TESTING)) {
-      // Prepare for calling test_garbagecollect_now(), need to know
-      // what variables are used on the call stack.
-      if (funcargs.ga_itemsize == 0) {
-        ga_init(&funcargs, (int)sizeof(typval_T *), 50);
-      }
-      for (i = 0; i < argcount; i++) {
-        ga_grow(&funcargs, 1);
-        ((typval_T **)funcargs.ga_data)[funcargs.ga_len++] = &argvars[i];
-      }
-    }
-    ret = call_func(name, len, rettv, argcount, argvars, funcexe);
-
-    funcargs.ga_len -= i;
+    ret = call_func_argvars(name, len, rettv, argcount, argvars, funcexe);
   } else if (!aborting() && evaluate) {
     if (argcount == MAX_FUNC_ARGS) {
       emsg_funcname(N_("E740: Too many arguments for function %s"), name);
@@ -596,6 +582,32 @@ int get_func_tv(const char *name, int len, typval_T *rettv, char **arg, evalarg_
   return ret;
 }
 
+/// Call a function with arguments that were already evaluated and put the
+/// result in "rettv".  Like get_func_tv(), the arguments are not cleared.
+///
+/// @return  OK or FAIL.
+int call_func_argvars(const char *name, int len, typval_T *rettv, int argcount,
+                      typval_T *argvars, funcexe_T *funcexe)
+{
+  int i = 0;
+
+  if (get_vim_var_nr(VV_TESTING)) {
+    // Prepare for calling test_garbagecollect_now(), need to know
+    // what variables are used on the call stack.
+    if (funcargs.ga_itemsize == 0) {
+      ga_init(&funcargs, (int)sizeof(typval_T *), 50);
+    }
+    for (i = 0; i < argcount; i++) {
+      ga_grow(&funcargs, 1);
+      ((typval_T **)funcargs.ga_data)[funcargs.ga_len++] = &argvars[i];
+    }
+  }
+  int ret = call_func(name, len, rettv, argcount, argvars, funcexe);
+
+  funcargs.ga_len -= i;
+  return ret;
+}
+
 #define FLEN_FIXED 40
 
 /// Check whether function name starts with <SID> or s:
@@ -838,6 +850,7 @@ static void cleanup_function_call(funccall_T *fc)
     // Link "fc" in the list for garbage collection later.
     fc->fc_caller = previous_funccal;
     previous_funccal = fc;
+    gc_refs_dropped = true;
 
     if (want_garbage_collect) {
       // If garbage collector is ready, clear count.
@@ -864,6 +877,7 @@ static void funccal_unref(funccall_T *fc, ufunc_T *fp, bool force)
   }
 
   fc->fc_refcount--;
+  gc_refs_dropped = true;
   if (force ? fc->fc_refcount <= 0 : !fc_referenced(fc)) {
     for (funccall_T **pfc = &previous_funccal; *pfc != NULL; pfc = &(*pfc)->fc_caller) {
       if (fc == *pfc) {
@@ -900,6 +914,7 @@ static void func_clear_items(ufunc_T *fp)
   ga_clear_strings(&(fp->uf_args));
   ga_clear_strings(&(fp->uf_def_args));
   ga_clear_strings(&(fp->uf_lines));
+  XFREE_CLEAR(fp->uf_skip_lines);
 
   if (fp->uf_flags & FC_LUAREF) {
     api_free_luaref(fp->uf_luaref);
@@ -2342,10 +2357,11 @@ static ufunc_T *list_one_function(exarg_T *eap, char *name, char *p)
 #define MAX_FUNC_NESTING 50
 
 /// Read the body of a function, put every line in "newlines".
+/// For each line "newskip" gets a bool telling whether get_func_line() can skip it.
 /// This stops at "endfunction".
-/// "newlines" must already have been initialized.
-static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in,
-                             char **line_to_free, bool show_block)
+/// "newlines" and "newskip" must already have been initialized.
+static int get_function_body(exarg_T *eap, garray_T *newlines, garray_T *newskip,
+                             char *line_arg_in, char **line_to_free, bool show_block)
 {
   bool saved_wait_return = need_wait_return;
   char *line_arg = line_arg_in;
@@ -2368,6 +2384,7 @@ static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in
     char *theline;
     char *p;
     char *arg;
+    bool skip_line = false;
 
     if (line_arg != NULL) {
       // Use eap->arg, split up in parts by line breaks.
@@ -2439,6 +2456,10 @@ static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in
       // skip ':' and blanks
       for (p = theline; ascii_iswhite(*p) || *p == ':'; p++) {}
 
+      // Comment and empty lines don't need to be executed.  Not for lines of
+      // a nested function, those are read with get_func_line() as its body.
+      skip_line = nesting == 0 && (*p == NUL || *p == '"');
+
       // Check for "endfunction".
       if (checkforcmd(&p, "endfunction", 4) && nesting-- == 0) {
         if (*p == '!') {
@@ -2585,6 +2606,8 @@ static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in
 
     // Add the line to the function.
     ga_grow(newlines, 1 + (int)sourcing_lnum_off);
+    ga_grow(newskip, 1 + (int)sourcing_lnum_off);
+    ((bool *)(newskip->ga_data))[newskip->ga_len++] = skip_line;
 
     // Copy the line to newly allocated memory.  get_one_sourceline()
     // allocates 250 bytes per line, this saves 80% on average.  The cost
@@ -2596,6 +2619,7 @@ static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in
     // equal to the index in the growarray.
     while (sourcing_lnum_off-- > 0) {
       ((char **)(newlines->ga_data))[newlines->ga_len++] = NULL;
+      ((bool *)(newskip->ga_data))[newskip->ga_len++] = false;
     }
 
     // Check for end of eap->arg.
@@ -2625,6 +2649,7 @@ void ex_function(exarg_T *eap)
   garray_T newargs;
   garray_T default_args;
   garray_T newlines;
+  garray_T newskip;
   int varargs = false;
   int flags = 0;
   ufunc_T *fp = NULL;
@@ -2709,6 +2734,7 @@ void ex_function(exarg_T *eap)
 
   ga_init(&newargs, (int)sizeof(char *), 3);
   ga_init(&newlines, (int)sizeof(char *), 3);
+  ga_init(&newskip, (int)sizeof(bool), 3);
 
   if (!eap->skip) {
     // Check the name of the function.  Unless it's a dictionary function
@@ -2814,7 +2840,7 @@ void ex_function(exarg_T *eap)
   linenr_T sourcing_lnum_top = SOURCING_LNUM;
 
   // Do not define the function when getting the body fails and when skipping.
-  if (get_function_body(eap, &newlines, line_arg, &line_to_free, show_block) == FAIL
+  if (get_function_body(eap, &newlines, &newskip, line_arg, &line_to_free, show_block) == FAIL
       || eap->skip) {
     goto erret;
   }
@@ -2944,6 +2970,7 @@ void ex_function(exarg_T *eap)
   fp->uf_args = newargs;
   fp->uf_def_args = default_args;
   fp->uf_lines = newlines;
+  fp->uf_skip_lines = newskip.ga_data;
   if ((flags & FC_CLOSURE) != 0) {
     register_closure(fp);
   } else {
@@ -2981,6 +3008,7 @@ errret_keep:
   ga_clear_strings(&newargs);
   ga_clear_strings(&default_args);
   ga_clear_strings(&newlines);
+  ga_clear(&newskip);
 ret_free:
   xfree(line_to_free);
   xfree(fudi.fd_newkey);
@@ -3161,6 +3189,7 @@ void ex_delfunction(exarg_T *eap)
         if (func_remove(fp)) {
           fp->uf_refcount--;
         }
+        gc_refs_dropped = true;
         fp->uf_flags |= FC_DELETED;
       } else {
         func_clear_free(fp, false);
@@ -3207,6 +3236,8 @@ void func_ptr_unref(ufunc_T *fp)
     if (fp->uf_calls == 0) {
       func_clear_free(fp, false);
     }
+  } else if (fp != NULL) {
+    gc_refs_dropped = true;
   }
 }
 
@@ -3729,9 +3760,13 @@ char *get_func_line(int c, void *cookie, int indent, bool do_concat)
       || fcp->fc_returned) {
     retval = NULL;
   } else {
-    // Skip NULL lines (continuation lines).
+    // Skip NULL lines (continuation lines).  Also skip comment and empty
+    // lines, unless they can be observed by profiling, debugging or 'verbose'.
+    const bool *skip_lines = do_profiling != PROF_YES && fcp->fc_breakpoint == 0
+                             && p_verbose < 15 ? fp->uf_skip_lines : NULL;
     while (fcp->fc_linenr < gap->ga_len
-           && ((char **)(gap->ga_data))[fcp->fc_linenr] == NULL) {
+           && (((char **)(gap->ga_data))[fcp->fc_linenr] == NULL
+               || (skip_lines != NULL && skip_lines[fcp->fc_linenr]))) {
       fcp->fc_linenr++;
     }
     if (fcp->fc_linenr >= gap->ga_len) {
@@ -13,10 +13,12 @@ enum { EVENT_HANDLER_MAX_ARGC = 10, };
 typedef void (*argv_callback)(void **argv);
 typedef struct {
   argv_callback handler;
+  const char *name;  ///< name of "handler", for 'stalltime'
   void *argv[EVENT_HANDLER_MAX_ARGC];
 } Event;
 
-#define event_create(cb, ...) ((Event){ .handler = cb, .argv = { __VA_ARGS__ } })
+#define event_create(cb, ...) \
+  ((Event){ .handler = cb, .name = #cb, .argv = { __VA_ARGS__ } })
 
 typedef struct multiqueue MultiQueue;
 typedef void (*PutCallback)(MultiQueue *multiq, void *data);
@@ -2,6 +2,9 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <uv.h>
+#ifndef MSWIN
+# include <poll.h>
+#endif
 
 #include "nvim/event/loop.h"
 #include "nvim/event/multiqueue.h"
@@ -9,6 +12,7 @@
 #include "nvim/memory.h"
 #include "nvim/os/time.h"
 #include "nvim/types_defs.h"
+#include "nvim/watchdog.h"
 
 #include "event/loop.c.generated.h"
 
@@ -56,7 +60,9 @@ static bool loop_uv_run(Loop *loop, int64_t ms)
     mode = UV_RUN_NOWAIT;
   }
 
+  watchdog_loop_enter();
   uv_run(&loop->uv, mode);
+  watchdog_loop_leave();
 
   if (ms > 0) {
     uv_timer_stop(&loop->poll_timer);
@@ -82,6 +88,22 @@ bool loop_poll_events(Loop *loop, int64_t ms)
   return timeout_expired;
 }
 
+/// Checks whether `Loop.uv` has I/O (e.g. input) to process, without
+/// processing any event.  Always false on Windows.
+bool loop_io_pending(Loop *loop)
+{
+#ifdef MSWIN
+  return false;
+#else
+  int fd = uv_backend_fd(&loop->uv);
+  if (fd < 0) {
+    return false;
+  }
+  struct pollfd pfd = { .fd = fd, .events = POLLIN };
+  return poll(&pfd, 1, 0) > 0;
+#endif
+}
+
 /// Schedules a fast event from another thread.
 ///
 /// @note Event is queued into `fast_events`, which is processed outside of the
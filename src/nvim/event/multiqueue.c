@@ -50,6 +50,7 @@
 #include "nvim/event/multiqueue.h"
 #include "nvim/lib/queue_defs.h"
 #include "nvim/memory.h"
+#include "nvim/watchdog.h"
 
 typedef struct multiqueue_item MultiQueueItem;
 struct multiqueue_item {
@@ -156,7 +157,9 @@ void multiqueue_process_events(MultiQueue *self)
   while (!multiqueue_empty(self)) {
     Event event = multiqueue_remove(self);
     if (event.handler) {
+      watchdog_activity_push("event", event.name);
       event.handler(event.argv);
+      watchdog_activity_pop();
     }
   }
 }
@@ -15,7 +15,7 @@
 #define CREATE_EVENT(multiqueue, handler, ...) \
   do { \
     if (multiqueue) { \
-      multiqueue_put((multiqueue), (handler), __VA_ARGS__); \
+      multiqueue_put((multiqueue), handler, __VA_ARGS__); \
     } else { \
       void *argv[] = { __VA_ARGS__ }; \
       (handler)(argv); \
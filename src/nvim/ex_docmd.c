@@ -2024,6 +2024,8 @@ static char *do_one_cmd(char **cmdlinep, int flags, cstack_T *cstack, LineGetter
   };
   ex_nesting_level++;
 
+  PROF_SAMPLE_CHECK();
+
   // When the last file has not been edited :q has to be typed twice.
   if (quitmore
       // avoid that a function call in 'statusline' does this
@@ -7745,6 +7747,8 @@ static void ex_shada(exarg_T *eap)
   }
   if (eap->cmdidx == CMD_rviminfo || eap->cmdidx == CMD_rshada) {
     shada_read_everything(eap->arg, eap->forceit, false);
+  } else if (p_sda && !eap->forceit) {
+    shada_write_file_async(eap->arg);
   } else {
     shada_write_file(eap->arg, eap->forceit);
   }
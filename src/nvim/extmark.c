@@ -258,26 +258,69 @@ bool extmark_clear(buf_T *buf, uint32_t ns_id, int l_row, colnr_T l_col, int u_r
 /// if upper_lnum or upper_col are negative the buffer
 /// will be searched to the start, or end
 /// amount = amount of marks to find or INT64_MAX for all
+/// hl_filter = only marks highlighting a range with this group, or 0 for all
+/// after = continue after the mark with this id in "ns_id", or 0
 ExtmarkInfoArray extmark_get(buf_T *buf, uint32_t ns_id, int l_row, colnr_T l_col, int u_row,
-                             colnr_T u_col, int64_t amount, ExtmarkType type_filter, bool overlap)
+                             colnr_T u_col, int64_t amount, ExtmarkType type_filter,
+                             int hl_filter, bool overlap, uint32_t after)
 {
   ExtmarkInfoArray array = KV_INITIAL_VALUE;
   MarkTreeIter itr[1];
+  MarkTree *b = buf->b_marktree;
+
+  // Marks with virtual lines are counted in the nodes of the marktree, subtrees
+  // without any are skipped.  Hidden marks are counted separately, they are
+  // returned like without the filter.
+  MetaFilter meta_filter = NULL;
+  if (type_filter == kExtmarkVirtLines && !overlap) {
+    static const uint32_t lines_filter[kMTMetaCount] = {
+      [kMTMetaLines] = kMTFilterSelect,
+      [kMTMetaLinesInvalid] = kMTFilterSelect,
+    };
+    meta_filter = lines_filter;
+  }
+  // the filtered iterator stops before "stop_row" and "stop_col"
+  int stop_row = u_row;
+  int stop_col = u_col;
+  if (u_col < MAXCOL) {
+    stop_col++;
+  } else if (u_row < MAXLNUM) {
+    stop_row++;
+    stop_col = 0;
+  }
+
+  MTKey cursor = MT_INVALID_KEY;
+  if (after != 0) {
+    cursor = marktree_lookup_ns(b, ns_id, after, false, itr);
+    if (cursor.pos.row < l_row || (cursor.pos.row == l_row && cursor.pos.col < l_col)) {
+      cursor = MT_INVALID_KEY;  // before the range, start from its beginning
+    }
+  }
 
-  if (overlap) {
+  if (cursor.pos.row >= 0) {
+    // Continue after the mark returned last by the previous call.
+    if (meta_filter
+        ? !marktree_itr_next_filter(b, itr, stop_row, stop_col, meta_filter)
+        : !marktree_itr_next(b, itr)) {
+      return array;
+    }
+  } else if (overlap) {
     // Find all the marks overlapping the start position
-    if (!marktree_itr_get_overlap(buf->b_marktree, l_row, l_col, itr)) {
+    if (!marktree_itr_get_overlap(b, l_row, l_col, itr)) {
       return array;
     }
 
     MTPair pair;
-    while (marktree_itr_step_overlap(buf->b_marktree, itr, &pair)) {
-      push_mark(&array, ns_id, type_filter, pair);
+    while (marktree_itr_step_overlap(b, itr, &pair)) {
+      push_mark(&array, ns_id, type_filter, hl_filter, pair);
+    }
+  } else if (meta_filter) {
+    if (!marktree_itr_get_filter(b, l_row, l_col, stop_row, stop_col, meta_filter, itr)) {
+      return array;
     }
   } else {
     // Find all the marks beginning with the start position
-    marktree_itr_get_ext(buf->b_marktree, MTPos(l_row, l_col),
-                         itr, false, false, NULL, NULL);
+    marktree_itr_get_ext(b, MTPos(l_row, l_col), itr, false, false, NULL, NULL);
   }
 
   while ((int64_t)kv_size(array) < amount) {
@@ -288,26 +331,35 @@ ExtmarkInfoArray extmark_get(buf_T *buf, uint32_t ns_id, int l_row, colnr_T l_co
       break;
     }
     if (!mt_end(mark)) {
-      MTKey end = marktree_get_alt(buf->b_marktree, mark, NULL);
-      push_mark(&array, ns_id, type_filter, mtpair_from(mark, end));
+      MTKey end = marktree_get_alt(b, mark, NULL);
+      push_mark(&array, ns_id, type_filter, hl_filter, mtpair_from(mark, end));
+    }
+    if (meta_filter) {
+      if (!marktree_itr_next_filter(b, itr, stop_row, stop_col, meta_filter)) {
+        break;
+      }
+    } else {
+      marktree_itr_next(b, itr);
     }
-    marktree_itr_next(buf->b_marktree, itr);
   }
   return array;
 }
 
-static void push_mark(ExtmarkInfoArray *array, uint32_t ns_id, ExtmarkType type_filter, MTPair mark)
+static void push_mark(ExtmarkInfoArray *array, uint32_t ns_id, ExtmarkType type_filter,
+                      int hl_filter, MTPair mark)
 {
   if (!(ns_id == UINT32_MAX || mark.start.ns == ns_id)) {
     return;
   }
-  if (type_filter != kExtmarkNone) {
+  if (type_filter != kExtmarkNone || hl_filter != 0) {
     if (!mt_decor_any(mark.start)) {
       return;
     }
-    uint16_t type_flags = decor_type_flags(mt_decor(mark.start));
-
-    if (!(type_flags & type_filter)) {
+    DecorInline decor = mt_decor(mark.start);
+    if (type_filter != kExtmarkNone && !(decor_type_flags(decor) & type_filter)) {
+      return;
+    }
+    if (hl_filter != 0 && !decor_has_hl_id(decor, hl_filter)) {
       return;
     }
   }
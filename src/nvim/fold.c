@@ -5,6 +5,7 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -123,6 +124,12 @@ static linenr_T invalid_bot = 0;
 static linenr_T prev_lnum = 0;
 static int prev_lnum_lvl = -1;
 
+// The last line foldexpr_line_set() was called for, and whether its state did
+// not change.  When it did, the remembered state of the lines below it, which
+// were not evaluated again, may be wrong.
+static linenr_T foldexpr_last_lnum = 0;
+static bool foldexpr_last_same = false;
+
 // Flags used for "done" argument of setManualFold.
 #define DONE_NOTHING    0
 #define DONE_ACTION     1       // did close or open a fold
@@ -757,6 +764,7 @@ void deleteFold(win_T *const wp, const linenr_T start, const linenr_T end, const
 void clearFolding(win_T *win)
 {
   deleteFoldRecurse(win->w_buffer, &win->w_folds);
+  kv_destroy(win->w_foldexpr_lines);
   win->w_foldinvalid = false;
 }
 
@@ -767,6 +775,9 @@ void clearFolding(win_T *win)
 /// The changes in lines from top to bot (inclusive).
 void foldUpdate(win_T *wp, linenr_T top, linenr_T bot)
 {
+  // The lines will be evaluated again, even when that is postponed.
+  foldexpr_lines_forget(wp, MIN(top, bot), MAX(top, bot));
+
   if (disable_fold_update || (State & MODE_INSERT && !foldmethodIsIndent(wp))) {
     return;
   }
@@ -1349,6 +1360,7 @@ void foldMarkAdjust(win_T *wp, linenr_T line1, linenr_T line2, linenr_T amount,
   if (line2 < line1) {
     line2 = line1;
   }
+  foldexpr_lines_adjust(wp, line1, line2, amount, amount_after);
   // If appending a line in Insert mode, it should be included in the fold
   // just above the line.
   if ((State & MODE_INSERT) && amount == 1 && line2 == MAXLNUM) {
@@ -1357,6 +1369,94 @@ void foldMarkAdjust(win_T *wp, linenr_T line1, linenr_T line2, linenr_T amount,
   foldMarkAdjustRecurse(wp, &wp->w_folds, line1, line2, amount, amount_after);
 }
 
+/// Move the remembered 'foldexpr' state of lines for inserted or deleted
+/// lines, see foldMarkAdjust() for the arguments.  The lines from "line1" to
+/// "line2" are forgotten.
+static void foldexpr_lines_adjust(win_T *wp, linenr_T line1, linenr_T line2, linenr_T amount,
+                                  linenr_T amount_after)
+{
+  size_t const size = kv_size(wp->w_foldexpr_lines);
+  line1 = MAX(line1, 1);
+  if ((size_t)line1 > size) {
+    return;
+  }
+  if (line2 == MAXLNUM && amount > 0 && amount != MAXLNUM) {
+    // Lines inserted above "line1", e.g. by ml_append().
+    line2 = line1 - 1;
+    amount_after = amount;
+  }
+  if (line2 == MAXLNUM || (size_t)line2 >= size || line2 + amount_after < line1 - 1) {
+    // Nothing is known below "line1" then.
+    kv_size(wp->w_foldexpr_lines) = (size_t)line1 - 1;
+    return;
+  }
+
+  size_t const tail = size - (size_t)line2;
+  size_t const dest = (size_t)(line2 + amount_after);
+  if (dest + tail > kv_max(wp->w_foldexpr_lines)) {
+    kv_resize(wp->w_foldexpr_lines, dest + tail);
+  }
+  FoldExprLine *const lines = wp->w_foldexpr_lines.items;
+  memmove(&lines[dest], &lines[line2], tail * sizeof(*lines));
+  kv_size(wp->w_foldexpr_lines) = dest + tail;
+  for (size_t i = (size_t)line1 - 1; i < dest; i++) {
+    lines[i].lvl_next = INT16_MIN;
+  }
+}
+
+/// Forget the remembered 'foldexpr' state of lines "top" to "bot", they were
+/// changed.
+static void foldexpr_lines_forget(win_T *wp, linenr_T top, linenr_T bot)
+{
+  size_t const size = kv_size(wp->w_foldexpr_lines);
+  for (linenr_T lnum = MAX(top, 1); lnum <= bot && (size_t)lnum <= size; lnum++) {
+    kv_A(wp->w_foldexpr_lines, lnum - 1).lvl_next = INT16_MIN;
+  }
+}
+
+/// Remember the state of a line after evaluating 'foldexpr' for it, so that
+/// updating folds after a change further down can start just above the
+/// change, instead of going back to a line with an absolute fold level.
+///
+/// Only a line with a known level is remembered: its "lvl_next" and "end" do
+/// not depend on lines above it or were computed from their right level.
+static void foldexpr_line_set(const fline_T *flp, linenr_T lnum)
+{
+  win_T *const wp = flp->wp;
+  foldexpr_last_lnum = lnum;
+  foldexpr_last_same = false;
+  if (flp->lvl < 0 || flp->lvl_next > INT16_MAX || flp->end > INT16_MAX
+      || lnum < 1 || lnum > wp->w_buffer->b_ml.ml_line_count) {
+    return;
+  }
+  if (wp->w_foldexpr_buf != wp->w_buffer->handle) {
+    kv_size(wp->w_foldexpr_lines) = 0;
+    wp->w_foldexpr_buf = wp->w_buffer->handle;
+  }
+  while (kv_size(wp->w_foldexpr_lines) < (size_t)lnum) {
+    kv_push(wp->w_foldexpr_lines, ((FoldExprLine){ .lvl_next = INT16_MIN }));
+  }
+  FoldExprLine *const line = &kv_A(wp->w_foldexpr_lines, lnum - 1);
+  foldexpr_last_same = line->lvl_next == flp->lvl_next && line->end == flp->end;
+  *line = (FoldExprLine){
+    .lvl_next = (int16_t)flp->lvl_next,
+    .end = (int16_t)flp->end,
+  };
+}
+
+/// Get the remembered state of line "lnum", see foldexpr_line_set().
+///
+/// @return  NULL if not known.
+static const FoldExprLine *foldexpr_line_get(win_T *wp, linenr_T lnum)
+{
+  if (wp->w_foldexpr_buf != wp->w_buffer->handle || lnum < 1
+      || (size_t)lnum > kv_size(wp->w_foldexpr_lines)
+      || kv_A(wp->w_foldexpr_lines, lnum - 1).lvl_next == INT16_MIN) {
+    return NULL;
+  }
+  return &kv_A(wp->w_foldexpr_lines, lnum - 1);
+}
+
 // foldMarkAdjustRecurse() {{{2
 static void foldMarkAdjustRecurse(win_T *wp, garray_T *gap, linenr_T line1, linenr_T line2,
                                   linenr_T amount, linenr_T amount_after)
@@ -1900,7 +2000,9 @@ static void foldUpdateIEMS(win_T *const wp, linenr_T top, linenr_T bot)
 
     // Mark all folds as maybe-small.
     setSmallMaybe(&wp->w_folds);
+    kv_size(wp->w_foldexpr_lines) = 0;
   }
+  foldexpr_last_lnum = 0;
 
   // add the context for "diff" folding
   if (foldmethodIsDiff(wp)) {
@@ -1986,6 +2088,16 @@ static void foldUpdateIEMS(win_T *const wp, linenr_T top, linenr_T bot)
     // Backup to a line for which the fold level is defined.  Since it's
     // always defined for line one, we will stop there.
     fline.lvl = -1;
+    if (getlevel == foldlevelExpr) {
+      // When the state of the line above is known, the level of this line
+      // can be computed from it, instead of going back to a line with a
+      // level that does not depend on the lines above it.
+      const FoldExprLine *prev = foldexpr_line_get(wp, fline.lnum - 1);
+      if (prev != NULL) {
+        fline.lvl = prev->lvl_next;
+        fline.end = prev->end;
+      }
+    }
     for (; !got_int; fline.lnum--) {
       // Reset lvl_next each time, because it will be set to a value for
       // the next line, but we search backwards here.
@@ -2088,6 +2200,11 @@ static void foldUpdateIEMS(win_T *const wp, linenr_T top, linenr_T bot)
   // There can't be any folds from start until end now.
   foldRemove(wp, &wp->w_folds, start, end);
 
+  if (getlevel == foldlevelExpr && foldexpr_last_lnum > 0 && !foldexpr_last_same
+      && (size_t)foldexpr_last_lnum < kv_size(wp->w_foldexpr_lines)) {
+    kv_size(wp->w_foldexpr_lines) = (size_t)foldexpr_last_lnum;
+  }
+
   // If some fold changed, need to redraw and position cursor.
   if (fold_changed && wp->w_p_fen) {
     changed_window_setting(wp);
@@ -2703,6 +2820,9 @@ static void truncate_fold(win_T *const wp, fold_T *fp, linenr_T end)
 void foldMoveRange(win_T *const wp, garray_T *gap, const linenr_T line1, const linenr_T line2,
                    const linenr_T dest)
 {
+  if (gap == &wp->w_folds) {
+    kv_size(wp->w_foldexpr_lines) = 0;
+  }
   fold_T *fp;
   const linenr_T range_len = line2 - line1 + 1;
   const linenr_T move_len = dest - line2;
@@ -2965,6 +3085,8 @@ static void foldlevelExpr(fline_T *flp)
     }
   }
 
+  foldexpr_line_set(flp, lnum);
+
   curwin = win;
   curbuf = curwin->w_buffer;
 }
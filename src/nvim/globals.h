@@ -217,6 +217,9 @@ EXTERN int debug_backtrace_level INIT( = 0);     // breakpoint backtrace level
 #define PROF_YES        1       ///< profiling busy
 #define PROF_PAUSED     2       ///< profiling paused
 EXTERN int do_profiling INIT( = PROF_NONE);      ///< PROF_ values
+/// Time (os_hrtime()) when the next ":profile sample" sample is due, zero when
+/// not sampling.
+EXTERN uint64_t prof_sample_next INIT( = 0);
 
 /// Exception currently being thrown.  Used to pass an exception to a different
 /// cstack.  Also used for discarding an exception before it is caught or made
@@ -42,6 +42,20 @@ static Map(int, int) blend_attr_entries = MAP_INIT;
 static Map(int, int) blendthrough_attr_entries = MAP_INIT;
 static Set(cstr_t) urls = SET_INIT;
 
+/// Results of hl_blend_attrs(), in front of the blend maps.  Composing a line
+/// blends cell by cell, and most cells of a line have the same attributes as
+/// one of the cells before them: this avoids looking up the front attributes and
+/// hashing for each cell.
+enum { BLEND_CACHE_SIZE = 64, };
+static struct {
+  int back_attr;
+  int front_attr;
+  int result;
+  bool through;         ///< "*through" passed to hl_blend_attrs()
+  bool through_result;  ///< "*through" set by hl_blend_attrs()
+  bool valid;
+} blend_cache[BLEND_CACHE_SIZE];
+
 #define attr_entry(i) attr_entries.keys[i]
 
 /// highlight entries private to a namespace
@@ -544,6 +558,7 @@ void clear_hl_tables(bool reinit)
     map_clear(int, &combine_attr_entries);
     map_clear(int, &blend_attr_entries);
     map_clear(int, &blendthrough_attr_entries);
+    memset(blend_cache, 0, sizeof(blend_cache));
     set_clear(cstr_t, &urls);
     memset(highlight_attr_last, -1, sizeof(highlight_attr_last));
     highlight_attr_set_all();
@@ -563,6 +578,7 @@ void hl_invalidate_blends(void)
 {
   map_clear(int, &blend_attr_entries);
   map_clear(int, &blendthrough_attr_entries);
+  memset(blend_cache, 0, sizeof(blend_cache));
   highlight_changed();
   update_window_hl(curwin, true);
 }
@@ -701,6 +717,29 @@ int hl_blend_attrs(int back_attr, int front_attr, bool *through)
     return front_attr;
   }
 
+  unsigned idx = ((unsigned)back_attr * 31 + (unsigned)front_attr * 2 + (*through ? 1 : 0))
+                 % BLEND_CACHE_SIZE;
+  if (blend_cache[idx].valid && blend_cache[idx].back_attr == back_attr
+      && blend_cache[idx].front_attr == front_attr && blend_cache[idx].through == *through) {
+    *through = blend_cache[idx].through_result;
+    return blend_cache[idx].result;
+  }
+
+  bool through_arg = *through;
+  int id = hl_blend_attrs_uncached(back_attr, front_attr, through);
+  if (id > 0) {
+    blend_cache[idx].back_attr = back_attr;
+    blend_cache[idx].front_attr = front_attr;
+    blend_cache[idx].result = id;
+    blend_cache[idx].through = through_arg;
+    blend_cache[idx].through_result = *through;
+    blend_cache[idx].valid = true;
+  }
+  return id;
+}
+
+static int hl_blend_attrs_uncached(int back_attr, int front_attr, bool *through)
+{
   HlAttrs fattrs_raw = syn_attr2entry(front_attr);
   HlAttrs fattrs = get_colors_force(fattrs_raw);
   int ratio = fattrs.hl_blend;
@@ -69,6 +69,7 @@
 #include "nvim/undo.h"
 #include "nvim/usercmd.h"
 #include "nvim/vim_defs.h"
+#include "nvim/watchdog.h"
 #include "nvim/window.h"
 
 #ifndef MSWIN
@@ -209,6 +210,26 @@ static void nlua_luv_error_event(void **argv)
   xfree(error);
 }
 
+/// Describes the Lua function below "nargs" arguments on the stack as the
+/// current activity, for 'stalltime'.
+static void nlua_activity_push(lua_State *lstate, int nargs)
+{
+  char name[100] = "";
+  if (watchdog_active()) {
+    // luv also accepts a table with a __call metamethod.
+    if (lua_isfunction(lstate, -1 - nargs)) {
+      lua_Debug ar;
+      lua_pushvalue(lstate, -1 - nargs);
+      if (lua_getinfo(lstate, ">S", &ar)) {  // pops the function
+        vim_snprintf(name, sizeof(name), "%s:%d", ar.short_src, ar.linedefined);
+      }
+    } else {
+      xstrlcpy(name, "callable object", sizeof(name));
+    }
+  }
+  watchdog_activity_push("lua", name);
+}
+
 /// Execute callback in "fast" context. Used for luv and some vim.ui_event
 /// callbacks where using the API directly is not safe.
 static int nlua_fast_cfpcall(lua_State *lstate, int nargs, int nresult, int flags)
@@ -219,7 +240,9 @@ static int nlua_fast_cfpcall(lua_State *lstate, int nargs, int nresult, int flag
   in_fast_callback++;
 
   int top = lua_gettop(lstate);
+  nlua_activity_push(lstate, nargs);
   int status = nlua_pcall(lstate, nargs, nresult);
+  watchdog_activity_pop();
   if (status) {
     if (status == LUA_ERRMEM && !(flags & LUVF_CALLBACK_NOEXIT)) {
       // consider out of memory errors unrecoverable, just like xmalloc()
@@ -379,7 +402,7 @@ static void nlua_schedule_event(void **argv)
   lua_State *const lstate = global_lstate;
   nlua_pushref(lstate, cb);
   nlua_unref_global(lstate, cb);
-  if (nlua_pcall(lstate, 0, 0)) {
+  if (nlua_call_ref_pcall(lstate, 0, 0)) {
     nlua_error(lstate, _("vim.schedule callback: %.*s"));
     ui_remove_cb(ns_id, true);
   }
@@ -834,7 +857,7 @@ static bool nlua_state_init(lua_State *const lstate) FUNC_ATTR_NONNULL_ALL
 
   nlua_common_vim_init(lstate, false, false);
 
-  // patch require() (only for --startuptime)
+  // patch require() and add vim._time_span() (only for --startuptime)
   if (time_fd != NULL) {
     lua_getglobal(lstate, "require");
     // Must do this after nlua_common_vim_init where nlua_global_refs is initialized.
@@ -842,6 +865,9 @@ static bool nlua_state_init(lua_State *const lstate) FUNC_ATTR_NONNULL_ALL
     lua_pop(lstate, 1);
     lua_pushcfunction(lstate, &nlua_require);
     lua_setglobal(lstate, "require");
+
+    lua_pushcfunction(lstate, &nlua_time_span);
+    lua_setfield(lstate, -2, "_time_span");
   }
 
   // internal vim._treesitter... API
@@ -1122,6 +1148,119 @@ static int nlua_require(lua_State *const lstate)
   return status == 0 ? 1 : lua_error(lstate);
 }
 
+/// vim._time_span() for --startuptime: adds a span to the trace.
+///
+/// Takes the span name and its start time, as returned by vim.uv.hrtime().
+///
+/// @param  lstate  Lua interpreter state.
+static int nlua_time_span(lua_State *const lstate)
+  FUNC_ATTR_NONNULL_ALL
+{
+  const char *name = luaL_checkstring(lstate, 1);
+  proftime_T start = (proftime_T)luaL_checknumber(lstate, 2);
+  time_span(name, start);
+  return 0;
+}
+
+/// Whether ":profile sample" uses the LuaJIT profiler to sample Lua code.
+static bool sample_jit = false;
+
+/// Call jit.profile.{fname}() with the "nargs" arguments on top of the stack.
+/// Returns false when not running LuaJIT.
+static bool nlua_sample_jit_call(lua_State *lstate, const char *fname, int nargs)
+{
+  lua_getglobal(lstate, "require");
+  lua_pushstring(lstate, "jit.profile");
+  if (nlua_pcall(lstate, 1, 1)) {
+    lua_pop(lstate, 1 + nargs);
+    return false;
+  }
+  lua_getfield(lstate, -1, fname);
+  lua_remove(lstate, -2);
+  lua_insert(lstate, -1 - nargs);
+  if (nlua_pcall(lstate, nargs, 0)) {
+    lua_pop(lstate, 1);
+    return false;
+  }
+  return true;
+}
+
+/// Called when ":profile sample" starts.  With LuaJIT, its profiler calls
+/// nlua_sample_jit_cb() on the main thread while Lua code (also compiled
+/// traces) runs.  Otherwise Lua code is only sampled at the safe points of
+/// PROF_SAMPLE_CHECK().
+void nlua_sample_start(void)
+{
+  if (sample_jit) {
+    return;
+  }
+  lua_State *const lstate = global_lstate;
+  lua_pushstring(lstate, "i1");
+  lua_pushcfunction(lstate, nlua_sample_jit_cb);
+  sample_jit = nlua_sample_jit_call(lstate, "start", 2);
+}
+
+/// Called when ":profile sample" stops.
+void nlua_sample_stop(void)
+{
+  if (!sample_jit) {
+    return;
+  }
+  nlua_sample_jit_call(global_lstate, "stop", 0);
+  sample_jit = false;
+}
+
+/// Add the Lua stack of "lstate", outermost function first, to the folded
+/// stack in "gap".
+static void nlua_sample_stack(lua_State *lstate, garray_T *gap)
+{
+  lua_Debug ar;
+  int depth = 0;
+  while (lua_getstack(lstate, depth, &ar)) {
+    depth++;
+  }
+  char frame[IOSIZE];
+  for (int level = depth - 1; level >= 0; level--) {
+    if (!lua_getstack(lstate, level, &ar) || !lua_getinfo(lstate, "Sn", &ar)) {
+      continue;
+    }
+    if (*ar.what == 'C') {
+      vim_snprintf(frame, sizeof(frame), "%s [C]", ar.name ? ar.name : "?");
+    } else if (*ar.what == 'm') {
+      vim_snprintf(frame, sizeof(frame), "main chunk %s", ar.short_src);
+    } else {
+      vim_snprintf(frame, sizeof(frame), "%s %s:%d", ar.name ? ar.name : "?", ar.short_src,
+               ar.linedefined);
+    }
+    prof_sample_frame(gap, frame);
+  }
+}
+
+/// Add the stack of the global Lua state to the folded stack in "gap".
+void nlua_sample_frames(garray_T *gap)
+{
+  nlua_sample_stack(global_lstate, gap);
+}
+
+/// Callback of the LuaJIT profiler: Lua code is running, so its stack goes
+/// above the Vimscript stack.
+///
+/// @param  lstate  Lua interpreter state, the interrupted thread is the first
+///                 argument.
+static int nlua_sample_jit_cb(lua_State *lstate)
+{
+  if (!prof_sample_due()) {
+    return 0;
+  }
+  lua_State *thread = lua_tothread(lstate, 1);
+  garray_T ga;
+  ga_init(&ga, 1, 200);
+  prof_sample_estack(&ga);
+  nlua_sample_stack(thread != NULL ? thread : global_lstate, &ga);
+  prof_sample_add(&ga);
+  return 0;
+}
+
 /// debug.debug: interaction with user while debugging.
 ///
 /// @param  lstate  Lua interpreter state.
@@ -1609,6 +1748,14 @@ static int mode_ret(LuaRetMode mode)
   return mode == kRetMulti ? LUA_MULTRET : 1;
 }
 
+static int nlua_call_ref_pcall(lua_State *lstate, int nargs, int nresults)
+{
+  nlua_activity_push(lstate, nargs);
+  int status = nlua_pcall(lstate, nargs, nresults);
+  watchdog_activity_pop();
+  return status;
+}
+
 Object nlua_call_ref_ctx(bool fast, LuaRef ref, const char *name, Array args, LuaRetMode mode,
                          Arena *arena, Error *err)
 {
@@ -1630,7 +1777,7 @@ Object nlua_call_ref_ctx(bool fast, LuaRef ref, const char *name, Array args, Lu
       api_set_error(err, kErrorTypeException, "fast context failure");
       return NIL;
     }
-  } else if (nlua_pcall(lstate, nargs, mode_ret(mode))) {
+  } else if (nlua_call_ref_pcall(lstate, nargs, mode_ret(mode))) {
     // if err is passed, the caller will deal with the error.
     if (err) {
       size_t len;
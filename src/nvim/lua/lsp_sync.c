@@ -0,0 +1,345 @@
+// Incremental document sync for LSP: computes the textDocument/didChange
+// change event of an "on_lines" change, see runtime/lua/vim/lsp/sync.lua.
+//
+// The range is found by comparing the lines before and after the change, the
+// deleted text is gone from the buffer.  Indices are 1-based like in Lua.
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nvim/lua/lsp_sync.h"
+#include "nvim/macros_defs.h"
+#include "nvim/mbyte.h"
+#include "nvim/mbyte_defs.h"
+
+typedef enum {
+  kLspEncodingUtf8,
+  kLspEncodingUtf16,
+  kLspEncodingUtf32,
+} LspEncoding;
+
+/// A position: line, byte index in the line and index in the encoding.
+typedef struct {
+  int64_t line;
+  int64_t byte;
+  int64_t chr;
+} SyncPos;
+
+typedef struct {
+  lua_State *lstate;
+  int prev;  ///< stack index of the lines before the change
+  int curr;  ///< stack index of the lines after the change
+  LspEncoding encoding;
+} SyncState;
+
+#include "lua/lsp_sync.c.generated.h"
+
+/// @return  line "lnum" of the lines at stack index "lines", or NULL.
+///          The string is kept alive by the table.
+static const char *sync_get_line(SyncState *s, int lines, int64_t lnum, size_t *len)
+{
+  const char *line = NULL;
+  lua_rawgeti(s->lstate, lines, (int)lnum);
+  if (lua_type(s->lstate, -1) == LUA_TSTRING) {
+    line = lua_tolstring(s->lstate, -1, len);
+  }
+  lua_pop(s->lstate, 1);
+  return line;
+}
+
+/// Like sync_get_line(), but raises an error naming the argument and the index
+/// when the line is missing.
+static const char *sync_check_line(SyncState *s, int lines, int64_t lnum, size_t *len)
+{
+  const char *line = sync_get_line(s, lines, lnum, len);
+  if (line == NULL) {
+    const char *msg = lua_pushfstring(s->lstate, "no line at index %d of %s", (int)lnum,
+                                      lines == s->prev ? "prev_lines" : "curr_lines");
+    luaL_argerror(s->lstate, lines, msg);
+  }
+  return line;
+}
+
+/// Like vim.str_utfindex(): the index in the encoding of byte index "idx".
+static int64_t sync_utfindex(SyncState *s, const char *line, size_t idx)
+{
+  if (s->encoding == kLspEncodingUtf8) {
+    return (int64_t)idx;
+  }
+  size_t codepoints = 0;
+  size_t codeunits = 0;
+  mb_utflen(line, idx, &codepoints, &codeunits);
+  return (int64_t)(s->encoding == kLspEncodingUtf16 ? codeunits : codepoints);
+}
+
+/// Like string.byte(): the byte at 1-based index "idx", negative counts from
+/// the end, -1 when out of range.
+static int sync_byte(const char *line, size_t len, int64_t idx)
+{
+  if (idx < 0) {
+    idx += (int64_t)len + 1;
+  }
+  if (idx <= 0 || idx > (int64_t)len) {
+    return -1;
+  }
+  return (uint8_t)line[idx - 1];
+}
+
+/// Like vim.str_utf_start() and vim.str_utf_end().
+static CharBoundsOff sync_utf_bounds(const char *line, size_t len, int64_t byte)
+{
+  size_t off = (size_t)byte - 1;
+  return utf_cp_bounds_len(line, line + off, (int)(len - off));
+}
+
+/// Aligns the 1-based "byte" in "line" to the start of the next character.
+static SyncPos sync_align_end(SyncState *s, const char *line, size_t len, int64_t lnum,
+                              int64_t byte)
+{
+  int64_t chr;
+  if (byte == 1 || len == 0) {
+    chr = byte;
+  } else if (byte == (int64_t)len + 1) {
+    chr = sync_utfindex(s, line, len) + 1;
+  } else {
+    CharBoundsOff bounds = sync_utf_bounds(line, len, byte);
+    if (bounds.begin_off > 0) {
+      byte += bounds.end_off;
+    }
+    if (byte <= (int64_t)len) {
+      chr = sync_utfindex(s, line, (size_t)byte - 1) + 1;
+    } else {
+      chr = sync_utfindex(s, line, len) + 1;
+    }
+  }
+  return (SyncPos){ lnum, byte, chr };
+}
+
+/// Finds the first difference between the previous and current lines,
+/// aligned to the start of its character.
+static SyncPos sync_start_range(SyncState *s, int64_t firstline, int64_t lastline,
+                                int64_t new_lastline)
+{
+  // No existing text changed, lines are inserted after "lastline".
+  if (firstline == lastline) {
+    size_t len;
+    const char *line = sync_get_line(s, s->prev, firstline - 1, &len);
+    if (line != NULL) {
+      return (SyncPos){ firstline - 1, (int64_t)len + 1, sync_utfindex(s, line, len) + 1 };
+    }
+    return (SyncPos){ firstline, 1, 1 };
+  }
+
+  // The first changed line was deleted.
+  if (firstline == new_lastline) {
+    return (SyncPos){ firstline, 1, 1 };
+  }
+
+  size_t prev_len;
+  size_t curr_len;
+  const char *prev_line = sync_check_line(s, s->prev, firstline, &prev_len);
+  const char *curr_line = sync_check_line(s, s->curr, firstline, &curr_len);
+
+  size_t same = 0;
+  size_t max = MIN(prev_len, curr_len);
+  while (same < max && prev_line[same] == curr_line[same]) {
+    same++;
+  }
+
+  int64_t byte = (int64_t)same + 1;
+  if (byte == 1) {
+    return (SyncPos){ firstline, 1, 1 };
+  } else if (byte == (int64_t)prev_len + 1) {
+    return (SyncPos){ firstline, byte, sync_utfindex(s, prev_line, prev_len) + 1 };
+  }
+  byte -= sync_utf_bounds(prev_line, prev_len, byte).begin_off;
+  return (SyncPos){ firstline, byte, sync_utfindex(s, prev_line, (size_t)byte - 1) + 1 };
+}
+
+/// Finds the last difference between the previous and current lines, aligned
+/// to the start of the next character: "prev_end" is the end of the replaced
+/// range, "curr_end" the end of the new text.
+static void sync_end_range(SyncState *s, SyncPos start, int64_t firstline, int64_t lastline,
+                           int64_t new_lastline, SyncPos *prev_end, SyncPos *curr_end)
+{
+  size_t prev_len;
+  size_t curr_len;
+
+  // Even if the buffer has become empty, it has an empty line.
+  const char *first = sync_get_line(s, s->curr, 1, &curr_len);
+  if (lua_objlen(s->lstate, s->curr) == 1 && first != NULL && curr_len == 0) {
+    const char *prev_line = sync_check_line(s, s->prev, lastline - 1, &prev_len);
+    *prev_end = (SyncPos){ lastline - 1, (int64_t)prev_len + 1,
+                           sync_utfindex(s, prev_line, prev_len) + 1 };
+    *curr_end = (SyncPos){ 1, 1, 1 };
+    return;
+  }
+  if (firstline == new_lastline) {
+    *prev_end = (SyncPos){ lastline - new_lastline + firstline, 1, 1 };
+    *curr_end = (SyncPos){ firstline, 1, 1 };
+    return;
+  }
+  if (firstline == lastline) {
+    *prev_end = (SyncPos){ firstline, 1, 1 };
+    *curr_end = (SyncPos){ new_lastline - lastline + firstline, 1, 1 };
+    return;
+  }
+
+  // "lastline" and "new_lastline" are the first lines not replaced.
+  int64_t prev_lnum = lastline - 1;
+  int64_t curr_lnum = new_lastline - 1;
+  const char *prev_line = sync_check_line(s, s->prev, prev_lnum, &prev_len);
+  const char *curr_line = sync_check_line(s, s->curr, curr_lnum, &curr_len);
+  int64_t prev_length = (int64_t)prev_len;
+  int64_t curr_length = (int64_t)curr_len;
+
+  // Compare from the end of the line, not beyond the start of the change.
+  int64_t byte_offset = 0;
+  if (prev_lnum == curr_lnum) {
+    int64_t max_length = start.line == prev_lnum
+                         ? MIN(prev_length - start.byte, curr_length - start.byte) + 1
+                         : MIN(prev_length, curr_length) + 1;
+    for (int64_t idx = 0; idx <= max_length; idx++) {
+      byte_offset = idx;
+      if (sync_byte(prev_line, prev_len, prev_length - idx)
+          != sync_byte(curr_line, curr_len, curr_length - idx)) {
+        break;
+      }
+    }
+  }
+
+  int64_t prev_end_byte = prev_length - byte_offset + 1;
+  *prev_end = sync_align_end(s, prev_line, prev_len, prev_lnum, MAX(prev_end_byte, 1));
+
+  if (curr_lnum < start.line) {
+    // Deletion, the new text cannot end before the start.
+    *curr_end = (SyncPos){ start.line, 1, 1 };
+  } else {
+    int64_t curr_end_byte = curr_length - byte_offset + 1;
+    *curr_end = sync_align_end(s, curr_line, curr_len, curr_lnum, MAX(curr_end_byte, 1));
+  }
+}
+
+/// Pushes the text of the current lines from "start" to "end".
+static void sync_push_text(SyncState *s, SyncPos start, SyncPos end, const char *line_ending,
+                           size_t line_ending_len)
+{
+  lua_State *lstate = s->lstate;
+  size_t len;
+  const char *line = sync_get_line(s, s->curr, start.line, &len);
+  if (line == NULL) {
+    lua_pushliteral(lstate, "");
+    return;
+  }
+
+  if (start.line == end.line) {
+    int64_t stop = MIN(end.byte - 1, (int64_t)len);
+    if (start.byte > stop) {
+      lua_pushliteral(lstate, "");
+    } else {
+      lua_pushlstring(lstate, line + start.byte - 1, (size_t)(stop - start.byte + 1));
+    }
+    return;
+  }
+
+  luaL_Buffer b;
+  luaL_buffinit(lstate, &b);
+  if (start.byte <= (int64_t)len) {
+    luaL_addlstring(&b, line + start.byte - 1, len - (size_t)start.byte + 1);
+  }
+  for (int64_t lnum = start.line + 1; lnum < end.line; lnum++) {
+    line = sync_get_line(s, s->curr, lnum, &len);
+    if (line != NULL) {
+      luaL_addlstring(&b, line_ending, line_ending_len);
+      luaL_addlstring(&b, line, len);
+    }
+  }
+  luaL_addlstring(&b, line_ending, line_ending_len);
+  line = sync_get_line(s, s->curr, end.line, &len);
+  if (line != NULL) {
+    luaL_addlstring(&b, line, (size_t)MIN(MAX(end.byte - 1, 0), (int64_t)len));
+  }
+  luaL_pushresult(&b);
+}
+
+/// Length of the replaced range in the encoding, line endings included.
+static int64_t sync_range_length(SyncState *s, SyncPos start, SyncPos end, size_t line_ending_len)
+{
+  if (start.line == end.line) {
+    return end.chr - start.chr;
+  }
+
+  size_t len;
+  int64_t range_length = (int64_t)line_ending_len;
+  const char *line = sync_get_line(s, s->prev, start.line, &len);
+  if (line != NULL && len > 0) {
+    range_length += sync_utfindex(s, line, len) - start.chr + 1;
+  }
+  for (int64_t lnum = start.line + 1; lnum < end.line; lnum++) {
+    line = sync_check_line(s, s->prev, lnum, &len);
+    range_length += sync_utfindex(s, line, len) + (int64_t)line_ending_len;
+  }
+  line = sync_get_line(s, s->prev, end.line, &len);
+  if (line != NULL && len > 0) {
+    range_length += end.chr - 1;
+  }
+  return range_length;
+}
+
+static void sync_push_position(lua_State *lstate, SyncPos pos, const char *key)
+{
+  lua_createtable(lstate, 0, 2);
+  lua_pushinteger(lstate, (lua_Integer)pos.line - 1);
+  lua_setfield(lstate, -2, "line");
+  lua_pushinteger(lstate, (lua_Integer)pos.chr - 1);
+  lua_setfield(lstate, -2, "character");
+  lua_setfield(lstate, -2, key);
+}
+
+/// vim._lsp_compute_diff(prev_lines, curr_lines, firstline, lastline, new_lastline,
+///                       position_encoding, line_ending)
+///
+/// Arguments as for vim.lsp.sync.compute_diff(), returns the
+/// lsp.TextDocumentContentChangeEvent.
+int nlua_lsp_compute_diff(lua_State *lstate)
+{
+  luaL_checktype(lstate, 1, LUA_TTABLE);
+  luaL_checktype(lstate, 2, LUA_TTABLE);
+  int64_t firstline = luaL_checkinteger(lstate, 3) + 1;
+  int64_t lastline = luaL_checkinteger(lstate, 4) + 1;
+  int64_t new_lastline = luaL_checkinteger(lstate, 5) + 1;
+  const char *encoding_name = luaL_optstring(lstate, 6, "utf-8");
+  size_t line_ending_len;
+  const char *line_ending = luaL_checklstring(lstate, 7, &line_ending_len);
+
+  SyncState s = { .lstate = lstate, .prev = 1, .curr = 2 };
+  if (strcmp(encoding_name, "utf-8") == 0) {
+    s.encoding = kLspEncodingUtf8;
+  } else if (strcmp(encoding_name, "utf-16") == 0) {
+    s.encoding = kLspEncodingUtf16;
+  } else if (strcmp(encoding_name, "utf-32") == 0) {
+    s.encoding = kLspEncodingUtf32;
+  } else {
+    return luaL_argerror(lstate, 6, "invalid encoding");
+  }
+
+  SyncPos start = sync_start_range(&s, firstline, lastline, new_lastline);
+  SyncPos prev_end;
+  SyncPos curr_end;
+  sync_end_range(&s, start, firstline, lastline, new_lastline, &prev_end, &curr_end);
+
+  lua_createtable(lstate, 0, 3);
+  lua_createtable(lstate, 0, 2);
+  sync_push_position(lstate, start, "start");
+  sync_push_position(lstate, prev_end, "end");
+  lua_setfield(lstate, -2, "range");
+  sync_push_text(&s, start, curr_end, line_ending, line_ending_len);
+  lua_setfield(lstate, -2, "text");
+  lua_pushinteger(lstate, (lua_Integer)sync_range_length(&s, start, prev_end, line_ending_len));
+  lua_setfield(lstate, -2, "rangeLength");
+  return 1;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <lua.h>  // IWYU pragma: keep
+
+#include "lua/lsp_sync.h.generated.h"
@@ -31,6 +31,7 @@
 #include "nvim/globals.h"
 #include "nvim/lua/base64.h"
 #include "nvim/lua/converter.h"
+#include "nvim/lua/lsp_sync.h"
 #include "nvim/lua/spell.h"
 #include "nvim/lua/stdlib.h"
 #include "nvim/lua/xdiff.h"
@@ -139,6 +140,50 @@ static int regex_match_line(lua_State *lstate)
   return nret;
 }
 
+/// Iterator step for regex:match_lines(). Skips non-matching lines without
+/// copying them to Lua, and returns the row and byte range of the next match.
+static int regex_match_lines_next(lua_State *lstate)
+{
+  regprog_T **prog = lua_touserdata(lstate, lua_upvalueindex(1));
+  buf_T *buf = nlua_buf_iter_get(lstate);
+  linenr_T row = (linenr_T)lua_tointeger(lstate, lua_upvalueindex(3));
+  linenr_T end = MIN((linenr_T)lua_tointeger(lstate, lua_upvalueindex(4)),
+                     buf->b_ml.ml_line_count);
+
+  for (; row < end; row++) {
+    regmatch_T rm;
+    rm.regprog = *prog;
+    rm.rm_ic = false;
+    char *line = ml_get_buf(buf, row + 1);
+    bool match = vim_regexec(&rm, line, 0);
+    *prog = rm.regprog;
+    if (!*prog) {
+      return luaL_error(lstate, "regex: internal error");
+    }
+
+    if (match) {
+      lua_pushinteger(lstate, row + 1);
+      lua_replace(lstate, lua_upvalueindex(3));
+      lua_pushinteger(lstate, row);
+      lua_pushinteger(lstate, (lua_Integer)(rm.startp[0] - line));
+      lua_pushinteger(lstate, (lua_Integer)(rm.endp[0] - line));
+      return 3;
+    }
+  }
+
+  lua_pushinteger(lstate, end);
+  lua_replace(lstate, lua_upvalueindex(3));
+  return 0;
+}
+
+static int regex_match_lines(lua_State *lstate)
+{
+  regex_check(lstate);
+  lua_settop(lstate, 4);
+  lua_pushvalue(lstate, 1);
+  return nlua_push_buf_iter(lstate, 2, regex_match_lines_next);
+}
+
 static regprog_T **regex_check(lua_State *L)
 {
   return luaL_checkudata(L, 1, "nvim_regex");
@@ -162,6 +207,7 @@ static struct luaL_Reg regex_meta[] = {
   { "__tostring", regex_tostring },
   { "match_str", regex_match_str },
   { "match_line", regex_match_line },
+  { "match_lines", regex_match_lines },
   { NULL, NULL }
 };
 
@@ -551,6 +597,88 @@ static int nlua_iconv(lua_State *lstate)
   return 1;
 }
 
+/// Gets the buffer of a line iterator, stored as upvalue 2 by nlua_push_buf_iter().
+static buf_T *nlua_buf_iter_get(lua_State *lstate)
+{
+  handle_T bufnr = (handle_T)lua_tointeger(lstate, lua_upvalueindex(2));
+  buf_T *buf = handle_get_buffer(bufnr);
+  if (!buf || buf->b_ml.ml_mfp == NULL) {
+    luaL_error(lstate, "invalid buffer");
+  }
+  return buf;
+}
+
+/// Pushes a line iterator closure over a buffer range.
+///
+/// Reads `bufnr`, `start` and `end_` (zero-based, end-exclusive, negative `end_` counts from the
+/// end like |nvim_buf_get_lines()|) starting at stack index `idx`. The value on top of the stack
+/// becomes upvalue 1 of `next`; the buffer handle, current row and end row follow as upvalues 2-4.
+static int nlua_push_buf_iter(lua_State *lstate, int idx, lua_CFunction next)
+{
+  handle_T bufnr = (handle_T)luaL_checkinteger(lstate, idx);
+  buf_T *buf = bufnr ? handle_get_buffer(bufnr) : curbuf;
+  if (!buf || buf->b_ml.ml_mfp == NULL) {
+    return luaL_error(lstate, "invalid buffer");
+  }
+
+  linenr_T line_count = buf->b_ml.ml_line_count;
+  lua_Integer start = luaL_optinteger(lstate, idx + 1, 0);
+  lua_Integer end = luaL_optinteger(lstate, idx + 2, -1);
+  if (end < 0) {
+    end += line_count + 1;
+  }
+  if (start < 0 || start > line_count) {
+    return luaL_error(lstate, "invalid start");
+  }
+  if (end < start || end > line_count) {
+    return luaL_error(lstate, "invalid end");
+  }
+
+  lua_pushinteger(lstate, buf->handle);
+  lua_pushinteger(lstate, start);
+  lua_pushinteger(lstate, end);
+  lua_pushcclosure(lstate, next, 4);
+  return 1;
+}
+
+/// Iterator step for vim.buf_lines(). Pushes the next line straight from the memline, without an
+/// intermediate API String or table.
+static int nlua_buf_lines_next(lua_State *lstate)
+{
+  buf_T *buf = nlua_buf_iter_get(lstate);
+  linenr_T row = (linenr_T)lua_tointeger(lstate, lua_upvalueindex(3));
+  // The buffer may have been shortened since the iterator was created.
+  linenr_T end = MIN((linenr_T)lua_tointeger(lstate, lua_upvalueindex(4)),
+                     buf->b_ml.ml_line_count);
+  if (row >= end) {
+    return 0;
+  }
+
+  lua_pushinteger(lstate, row + 1);
+  lua_replace(lstate, lua_upvalueindex(3));
+
+  char *line = ml_get_buf(buf, row + 1);
+  size_t len = (size_t)ml_get_buf_len(buf, row + 1);
+  lua_pushinteger(lstate, row);
+  // Vim represents NULs as NLs
+  if (memchr(line, '\n', len)) {
+    char *tmp = xmemdupz(line, len);
+    memchrsub(tmp, '\n', NUL, len);
+    lua_pushlstring(lstate, tmp, len);
+    xfree(tmp);
+  } else {
+    lua_pushlstring(lstate, line, len);
+  }
+  return 2;
+}
+
+static int nlua_buf_lines(lua_State *lstate)
+{
+  lua_settop(lstate, 3);
+  lua_pushnil(lstate);  // unused upvalue 1
+  return nlua_push_buf_iter(lstate, 1, nlua_buf_lines_next);
+}
+
 // Update foldlevels (e.g., by evaluating 'foldexpr') for the given line range in the given window,
 // without invoking other side effects. Unlike `zx`, it does not close manually opened folds and
 // does not open folds under the cursor.
@@ -707,6 +835,12 @@ void nlua_state_add_stdlib(lua_State *const lstate, bool is_thread)
     // str_utf_end
     lua_pushcfunction(lstate, &nlua_str_utf_end);
     lua_setfield(lstate, -2, "str_utf_end");
+    // buf_lines
+    lua_pushcfunction(lstate, &nlua_buf_lines);
+    lua_setfield(lstate, -2, "buf_lines");
+    // _lsp_compute_diff
+    lua_pushcfunction(lstate, &nlua_lsp_compute_diff);
+    lua_setfield(lstate, -2, "_lsp_compute_diff");
     // regex
     lua_pushcfunction(lstate, &nlua_regex);
     lua_setfield(lstate, -2, "regex");
@@ -800,7 +800,11 @@ void getout(int exitval)
     }
   }
 
+  // Join a ShaDa file written in the background by ":wshada".
+  shada_bg_wait();
+
   profile_dump();
+  prof_sample_stop();
 
   if (did_emsg) {
     // give the user a chance to read the (error) message
@@ -169,6 +169,15 @@ static inline int marktree_getp_aux(const MTNode *x, MTKey k, bool *match)
   return begin;
 }
 
+/// Last stamp given to a tree by marktree_changed().
+static uint64_t marktree_last_stamp = 0;
+
+/// Records that the marks of "b" changed, for caches of its marks.
+static inline void marktree_changed(MarkTree *b)
+{
+  b->stamp = ++marktree_last_stamp;
+}
+
 static inline void refkey(MarkTree *b, MTNode *x, int i)
 {
   pmap_put(uint64_t)(b->id2node, mt_lookup_key(x->key[i]), x);
@@ -456,6 +465,8 @@ static void meta_describe_key_inc(uint32_t *meta_inc, MTKey *k)
     meta_inc[kMTMetaSignHL] += (k->flags & MT_FLAG_DECOR_SIGNHL) ? 1 : 0;
     meta_inc[kMTMetaSignText] += (k->flags & MT_FLAG_DECOR_SIGNTEXT) ? 1 : 0;
     meta_inc[kMTMetaConcealLines] += (k->flags & MT_FLAG_DECOR_CONCEAL_LINES) ? 1 : 0;
+  } else if (!mt_end(*k)) {
+    meta_inc[kMTMetaLinesInvalid] += (k->flags & MT_FLAG_DECOR_VIRT_LINES) ? 1 : 0;
   }
 }
 
@@ -492,6 +503,7 @@ static bool meta_has(const uint32_t *meta_count, MetaFilter meta_filter)
 
 void marktree_put_key(MarkTree *b, MTKey k)
 {
+  marktree_changed(b);
   k.flags |= MT_FLAG_REAL;  // let's be real.
   if (!b->root) {
     b->root = marktree_alloc_node(b, true);
@@ -545,6 +557,7 @@ void marktree_put_key(MarkTree *b, MTKey k)
 ///            recommended strategy is to always iterate forward)
 uint64_t marktree_del_itr(MarkTree *b, MarkTreeIter *itr, bool rev)
 {
+  marktree_changed(b);
   int adjustment = 0;
 
   MTNode *cur = itr->x;
@@ -781,6 +794,7 @@ uint64_t marktree_del_itr(MarkTree *b, MarkTreeIter *itr, bool rev)
 
 void marktree_revise_meta(MarkTree *b, MarkTreeIter *itr, MTKey old_key)
 {
+  marktree_changed(b);
   uint32_t meta_old[kMTMetaCount], meta_new[kMTMetaCount];
   meta_describe_key(meta_old, old_key);
   meta_describe_key(meta_new, rawkey(itr));
@@ -1290,6 +1304,7 @@ static void pivot_left(MarkTree *b, MTPos p_pos, MTNode *p, int i)
 /// frees all mem, resets tree to valid empty state
 void marktree_clear(MarkTree *b)
 {
+  marktree_changed(b);
   if (b->root) {
     marktree_free_subtree(b, b->root);
     b->root = NULL;
@@ -1320,6 +1335,7 @@ static void marktree_free_node(MarkTree *b, MTNode *x)
 /// @param itr iterator is invalid after call
 void marktree_move(MarkTree *b, MarkTreeIter *itr, int row, int col)
 {
+  marktree_changed(b);
   MTKey key = rawkey(itr);
   MTNode *x = itr->x;
   if (!x->level) {
@@ -1378,6 +1394,7 @@ void marktree_move(MarkTree *b, MarkTreeIter *itr, int row, int col)
 
 void marktree_restore_pair(MarkTree *b, MTKey key)
 {
+  marktree_changed(b);
   MarkTreeIter itr[1];
   MarkTreeIter end_itr[1];
   marktree_lookup(b, mt_lookup_key_side(key, false), itr);
@@ -1923,6 +1940,9 @@ bool marktree_splice(MarkTree *b, int32_t start_line, int start_col, int old_ext
   MTPos old_extent = { old_extent_line, old_extent_col };
   MTPos new_extent = { new_extent_line, new_extent_col };
 
+  // Marks after the change move, even when none is deleted.
+  marktree_changed(b);
+
   bool may_delete = (old_extent.row != 0 || old_extent.col != 0);
   bool same_line = old_extent.row == 0 && new_extent.row == 0;
   unrelative(start, &old_extent);
@@ -28,6 +28,7 @@ typedef enum {
   kMTMetaSignHL,
   kMTMetaSignText,
   kMTMetaConcealLines,
+  kMTMetaLinesInvalid,  // hidden marks with virt_lines, only for extmark_get()
   kMTMetaCount,  // sentinel, must be last
 } MetaIndex;
 
@@ -99,4 +100,7 @@ typedef struct {
   uint32_t meta_root[kMTMetaCount];
   size_t n_keys, n_nodes;
   PMap(uint64_t) id2node[1];
+  /// Changed by every change of the marks, unique among all trees.  Zero when
+  /// the tree was never changed.
+  uint64_t stamp;
 } MarkTree;
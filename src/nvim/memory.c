@@ -34,6 +34,8 @@
 #include "nvim/memory.h"
 #include "nvim/message.h"
 #include "nvim/option_vars.h"
+#include "nvim/runtime.h"
+#include "nvim/shada.h"
 #include "nvim/sign.h"
 #include "nvim/state_defs.h"
 #include "nvim/statusline.h"
@@ -42,6 +44,7 @@
 #include "nvim/ui_client.h"
 #include "nvim/ui_compositor.h"
 #include "nvim/usercmd.h"
+#include "nvim/watchdog.h"
 
 #ifdef UNIT_TESTING
 # define malloc(size) mem_malloc(size)
@@ -864,6 +867,8 @@ void free_all_mem(void)
   if (entered_free_all_mem) {
     return;
   }
+  // Stop the watchdog thread before logging is no longer allowed.
+  watchdog_free_all_mem();
   entered_free_all_mem = true;
   // Don't want to trigger autocommands from here on.
   block_autocmds();
@@ -998,6 +1003,7 @@ void free_all_mem(void)
 
   decor_free_all_mem();
   drawline_free_all_mem();
+  runtime_index_free_all_mem();
 
   if (ui_client_channel_id) {
     ui_client_free_all_mem();
@@ -1009,6 +1015,7 @@ void free_all_mem(void)
   nlua_free_all_mem();
   rpc_free_all_mem();
   autocmd_free_all_mem();
+  shada_free_all_mem();
 
   // should be last, in case earlier free functions deallocates arenas
   arena_free_reuse_blks();
@@ -32,6 +32,7 @@
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 #include "nvim/ui_client.h"
+#include "nvim/watchdog.h"
 
 #include "msgpack_rpc/channel.c.generated.h"
 
@@ -361,7 +362,9 @@ static void request_event(void **argv)
     goto free_ret;
   }
 
+  watchdog_activity_push("rpc", handler.name);
   Object result = handler.fn(channel->id, e->args, &e->used_mem, &error);
+  watchdog_activity_pop();
   if (e->type == kMessageTypeRequest || ERROR_SET(&error)) {
     // Send the response.
     serialize_response(channel, e->handler, e->type, e->request_id, &error, &result);
@@ -110,6 +110,7 @@
 #include "nvim/undo.h"
 #include "nvim/undo_defs.h"
 #include "nvim/vim_defs.h"
+#include "nvim/watchdog.h"
 #include "nvim/window.h"
 #include "nvim/winfloat.h"
 
@@ -149,6 +150,15 @@ static OptInt p_tw_nopaste;
 static OptInt p_wm_nopaste;
 static char *p_vsts_nopaste;
 
+// While set_options_value_for() sets options for this window and buffer, the
+// redraw flags of the options are collected here and check_redraw() is called
+// once at the end.  Options with kOptFlagHLOnly are kept apart, they redraw
+// differently.
+static win_T *batch_win = NULL;
+static buf_T *batch_buf = NULL;
+static uint32_t batch_redraw_flags = 0;
+static uint32_t batch_redraw_flags_hl = 0;
+
 #define OPTION_COUNT ARRAY_SIZE(options)
 
 /// :set boolean option prefix
@@ -1835,6 +1845,10 @@ static void apply_optionset_autocmd(OptIndex opt_idx, int opt_flags, OptVal oldv
   if (starting || errmsg != NULL || *get_vim_var_str(VV_OPTION_TYPE) != NUL) {
     return;
   }
+  // Avoid setting the v:option_ variables when nothing will see them.
+  if (!has_event(EVENT_OPTIONSET)) {
+    return;
+  }
 
   char buf_type[7];
   typval_T oldval_tv = optval_as_tv(oldval, false);
@@ -2835,6 +2849,7 @@ static const char *validate_num_option(OptIndex opt_idx, OptInt *newval, char *e
   case kOptUpdatecount:
   case kOptReport:
   case kOptUpdatetime:
+  case kOptStalltime:
   case kOptSidescroll:
   case kOptFoldlevel:
   case kOptShiftwidth:
@@ -3572,7 +3587,11 @@ static const char *did_set_option(OptIndex opt_idx, void *varp, OptVal old_value
     curwin->w_set_curswant = true;
   }
 
-  check_redraw(opt->flags);
+  if (batch_win == curwin && batch_buf == curbuf) {
+    *((opt->flags & kOptFlagHLOnly) ? &batch_redraw_flags_hl : &batch_redraw_flags) |= opt->flags;
+  } else {
+    check_redraw(opt->flags);
+  }
 
   if (errmsg == NULL) {
     opt->flags |= kOptFlagWasSet;
@@ -4004,6 +4023,104 @@ void set_option_value_for(const char *name, OptIndex opt_idx, OptVal value, cons
   }
 }
 
+/// Set the values of several options for buffer / window.  Like calling
+/// set_option_value_for() for each option, but switches to the window or buffer
+/// only once and checks what needs to be redrawn once for all options.
+///
+/// Stops at the first option that cannot be set, the options before it keep
+/// their new value.
+///
+/// @param       names       Option names.
+/// @param       opt_idxs    Option indexes in options[] table.
+/// @param[in]   values      Option values.
+/// @param[in]   opt_flags   Flags for each option: OPT_LOCAL, OPT_GLOBAL, or 0 (both).
+/// @param       count       Number of options.
+/// @param       scope       Option scope. See OptScope in option.h.
+/// @param[in]   from        Target buffer/window.
+/// @param[out]  err         Error message, if any.
+void set_options_value_for(const char **names, const OptIndex *opt_idxs,
+                           const OptVal *values, const int *opt_flags, size_t count,
+                           const OptScope scope, void *const from, Error *err)
+{
+  switchwin_T switchwin;
+  aco_save_T aco;
+  void *ctx = scope == kOptScopeWin ? (void *)&switchwin
+                                    : (scope == kOptScopeBuf ? (void *)&aco : NULL);
+
+  bool switched = switch_option_context(ctx, scope, from, err);
+  if (ERROR_SET(err)) {
+    return;
+  }
+
+  win_T *const save_batch_win = batch_win;
+  buf_T *const save_batch_buf = batch_buf;
+  const uint32_t save_flags = batch_redraw_flags;
+  const uint32_t save_flags_hl = batch_redraw_flags_hl;
+  batch_win = curwin;
+  batch_buf = curbuf;
+  batch_redraw_flags = 0;
+  batch_redraw_flags_hl = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    const char *const errmsg = set_option_value_handle_tty(names[i], opt_idxs[i], values[i],
+                                                           opt_flags[i]);
+    if (errmsg) {
+      api_set_error(err, kErrorTypeException, "%s", errmsg);
+      break;
+    }
+  }
+
+  // Autocommands may have closed the window or buffer.
+  if (win_valid_any_tab(batch_win) && buf_valid(batch_buf)) {
+    if (batch_redraw_flags != 0) {
+      check_redraw_for(batch_buf, batch_win, batch_redraw_flags);
+    }
+    if (batch_redraw_flags_hl != 0) {
+      check_redraw_for(batch_buf, batch_win, batch_redraw_flags_hl);
+    }
+  }
+  batch_win = save_batch_win;
+  batch_buf = save_batch_buf;
+  batch_redraw_flags = save_flags;
+  batch_redraw_flags_hl = save_flags_hl;
+
+  if (switched) {
+    restore_option_context(ctx, scope);
+  }
+}
+
+/// Get the values of several options for buffer / window, switching to it only
+/// once.  See get_option_value_for().
+///
+/// @param       opt_idxs    Option indexes in options[] table.
+/// @param[out]  values      Option values, must be freed by caller.
+/// @param       count       Number of options.
+/// @param[in]   opt_flags   Option flags (can be OPT_LOCAL, OPT_GLOBAL or a combination).
+/// @param       scope       Option scope. See OptScope in option.h.
+/// @param[in]   from        Target buffer/window.
+/// @param[out]  err         Error message, if any.
+void get_options_value_for(const OptIndex *opt_idxs, OptVal *values, size_t count, int opt_flags,
+                           const OptScope scope, void *const from, Error *err)
+{
+  switchwin_T switchwin;
+  aco_save_T aco;
+  void *ctx = scope == kOptScopeWin ? (void *)&switchwin
+                                    : (scope == kOptScopeBuf ? (void *)&aco : NULL);
+
+  bool switched = switch_option_context(ctx, scope, from, err);
+  if (ERROR_SET(err)) {
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    values[i] = get_option_value(opt_idxs[i], opt_flags);
+  }
+
+  if (switched) {
+    restore_option_context(ctx, scope);
+  }
+}
+
 /// if 'all' == false: show changed options
 /// if 'all' == true: show all normal options
 ///
@@ -512,6 +512,7 @@ EXTERN char *p_spo;             ///< 'spelloptions'
 EXTERN unsigned spo_flags;
 EXTERN char *p_sps;             ///< 'spellsuggest'
 EXTERN int p_spr;               ///< 'splitright'
+EXTERN OptInt p_stt;            ///< 'stalltime'
 EXTERN int p_sol;               ///< 'startofline'
 EXTERN char *p_su;              ///< 'suffixes'
 EXTERN char *p_swb;             ///< 'switchbuf'
@@ -548,6 +549,7 @@ EXTERN OptInt p_ur;             ///< 'undoreload'
 EXTERN OptInt p_uc;             ///< 'updatecount'
 EXTERN OptInt p_ut;             ///< 'updatetime'
 EXTERN char *p_shada;           ///< 'shada'
+EXTERN int p_sda;               ///< 'shadaasync'
 EXTERN char *p_shadafile;       ///< 'shadafile'
 EXTERN int p_termsync;          ///< 'termsync'
 EXTERN char *p_vsts;            ///< 'varsofttabstop'
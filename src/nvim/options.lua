@@ -7591,6 +7591,24 @@ local options = {
       type = 'string',
       varname = 'p_shada',
     },
+    {
+      abbreviation = 'sda',
+      defaults = false,
+      desc = [=[
+        When on, |:wshada| without [!] only merges and serializes the
+        |shada-file| in the main loop.  Writing the result to disk, calling
+        fsync() (see 'fsync') and renaming it over the ShaDa file is done in
+        the background, so that writing the ShaDa file from a timer or an
+        autocommand does not block editing.  Errors are reported later.
+        Reading or writing the ShaDa file again, and exiting Nvim, first
+        waits for the background write to finish.
+      ]=],
+      full_name = 'shadaasync',
+      scope = { 'global' },
+      short_desc = N_('write shada file in the background'),
+      type = 'boolean',
+      varname = 'p_sda',
+    },
     {
       abbreviation = 'sdf',
       alias = { 'vif', 'viminfofile' },
@@ -8676,6 +8694,25 @@ local options = {
       type = 'boolean',
       varname = 'p_spr',
     },
+    {
+      abbreviation = 'stt',
+      cb = 'did_set_stalltime',
+      defaults = 0,
+      desc = [=[
+        When non-zero, a watchdog thread logs to |$NVIM_LOG_FILE| when the
+        main loop is busy for more than this many milliseconds without
+        checking for input or events, e.g. because a plugin callback takes
+        long.  The log shows what was running: the event handler, RPC method,
+        autocommand and Lua callback, outermost first.  The last 100 stalls
+        can be obtained with `nvim__stalls()`.
+        When zero, the watchdog is not running.
+      ]=],
+      full_name = 'stalltime',
+      scope = { 'global' },
+      short_desc = N_('log when the main loop is busy this many milliseconds'),
+      type = 'number',
+      varname = 'p_stt',
+    },
     {
       abbreviation = 'sol',
       defaults = false,
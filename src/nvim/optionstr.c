@@ -41,6 +41,7 @@
 #include "nvim/option_vars.h"
 #include "nvim/optionstr.h"
 #include "nvim/os/os.h"
+#include "nvim/plines.h"
 #include "nvim/pos_defs.h"
 #include "nvim/regexp.h"
 #include "nvim/regexp_defs.h"
@@ -2524,6 +2525,7 @@ char *get_listchars_name(expand_T *xp FUNC_ATTR_UNUSED, int idx)
 /// @return  an untranslated error message if any of them is invalid, NULL otherwise.
 const char *check_chars_options(void)
 {
+  vcol_cache_invalidate();
   if (set_chars_option(curwin, p_lcs, kListchars, false, NULL, 0) != NULL) {
     return e_conflicts_with_value_of_listchars;
   }
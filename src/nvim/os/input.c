@@ -202,6 +202,7 @@ void os_breakcheck(void)
     return;
   }
 
+  PROF_SAMPLE_CHECK();
   loop_poll_events(&main_loop, 0);
 }
 
@@ -519,6 +520,11 @@ static TriState inbuf_poll(int ms, MultiQueue *events)
     prof_input_end();
   }
 
+  if (ms != 0) {
+    // Do not count waiting for input as the next code that runs.
+    prof_sample_done();
+  }
+
   if (os_input_ready(events)) {
     return kTrue;
   }
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "klib/kvec.h"
 #include "nvim/api/extmark.h"
 #include "nvim/ascii_defs.h"
 #include "nvim/buffer.h"
@@ -31,6 +32,14 @@
 #include "nvim/state_defs.h"
 #include "nvim/types_defs.h"
 
+enum {
+  VCOL_CACHE_MINLEN = 1024,     ///< shorter lines are not cached
+  VCOL_CHECKPOINT_BYTES = 256,  ///< bytes between checkpoints of a cached line
+};
+
+/// Incremented when the width of characters may have changed.
+static unsigned vcol_cache_generation = 0;
+
 #include "plines.c.generated.h"
 
 /// Functions calculating horizontal size of text, when displayed in a window.
@@ -76,7 +85,14 @@ int linetabsize_col(int startvcol, char *s)
 /// Doesn't count the size of 'listchars' "eol".
 int linetabsize(win_T *wp, linenr_T lnum)
 {
-  return win_linetabsize(wp, lnum, ml_get_buf(wp->w_buffer, lnum), MAXCOL);
+  char *line = ml_get_buf(wp->w_buffer, lnum);
+  CharsizeArg csarg;
+  CSType const cstype = init_charsize_arg(&csarg, wp, lnum, line);
+  if (cstype == kCharsizeFast) {
+    return linesize_fast_lnum(&csarg, lnum);
+  } else {
+    return linesize_regular(&csarg, 0, MAXCOL);
+  }
 }
 
 /// Like linetabsize(), but counts the size of 'listchars' "eol".
@@ -490,6 +506,141 @@ int linesize_fast(CharsizeArg const *const csarg, int vcol_arg, colnr_T const le
   return vcol_arg;
 }
 
+/// Like linesize_fast() with "vcol_arg" zero and "len" MAXCOL, for line "lnum"
+/// of "csarg->win".  Uses the window's cache for long lines.
+static int linesize_fast_lnum(CharsizeArg const *const csarg, linenr_T lnum)
+{
+  VcolCacheLine *cl = vcol_cache_get(csarg->win, lnum, csarg->line, csarg->use_tabstop);
+  if (cl != NULL) {
+    return cl->width;
+  }
+  return linesize_fast(csarg, 0, MAXCOL);
+}
+
+/// Called when the width of characters may have changed, e.g. 'ambiwidth'.
+void vcol_cache_invalidate(void)
+{
+  vcol_cache_generation++;
+}
+
+/// Get the cached virtual columns of line "lnum" in window "wp", computing
+/// them when needed.  Moving the cursor in a very long line then does not
+/// measure the line from its start on every keystroke.
+///
+/// Can only be used when CSType is kCharsizeFast.
+///
+/// @param line  the text of the line, as returned by ml_get_buf()
+///
+/// @return  NULL when the line is too short to be worth caching.
+static VcolCacheLine *vcol_cache_get(win_T *wp, linenr_T lnum, const char *line,
+                                     bool use_tabstop)
+{
+  buf_T *const buf = wp->w_buffer;
+  if (lnum <= 0 || buf->b_p_vts_array != NULL) {
+    return NULL;
+  }
+  colnr_T const len = ml_get_buf_len(buf, lnum);
+  if (len < VCOL_CACHE_MINLEN) {
+    return NULL;
+  }
+
+  // A double-width character wraps early at the border of the window, see
+  // in_win_border().
+  bool const border = wp->w_p_wrap && wp->w_view_width > 0;
+  int width1 = 0;
+  int width2 = 0;
+  if (border) {
+    width1 = wp->w_view_width - win_col_off(wp);
+    width2 = width1 + win_col_off2(wp);
+  }
+  varnumber_T const changedtick = buf_get_changedtick(buf);
+
+  for (int i = 0; i < VCOL_CACHE_LINES; i++) {
+    VcolCacheLine *cl = &wp->w_vcol_cache[i];
+    if (cl->buf == buf->handle && cl->lnum == lnum && cl->changedtick == changedtick
+        && cl->line == line && cl->len == len && cl->generation == vcol_cache_generation
+        && cl->ts == buf->b_p_ts && cl->use_tabstop == use_tabstop && cl->border == border
+        && cl->width1 == width1 && cl->width2 == width2) {
+      return cl;
+    }
+  }
+
+  VcolCacheLine *cl = &wp->w_vcol_cache[wp->w_vcol_cache_next];
+  wp->w_vcol_cache_next = (wp->w_vcol_cache_next + 1) % VCOL_CACHE_LINES;
+  cl->buf = 0;
+  kv_size(cl->checkpoints) = 0;
+
+  int64_t vcol = 0;
+  colnr_T next_checkpoint = 0;
+  StrCharInfo ci = utf_ptr2StrCharInfo((char *)line);
+  while (*ci.ptr != NUL) {
+    colnr_T const col = (colnr_T)(ci.ptr - line);
+    if (col >= next_checkpoint) {
+      kv_push(cl->checkpoints, ((VcolCheckpoint){ .col = col, .vcol = (colnr_T)vcol }));
+      next_checkpoint = (col / VCOL_CHECKPOINT_BYTES + 1) * VCOL_CHECKPOINT_BYTES;
+    }
+    vcol += charsize_fast_impl(wp, ci.ptr, use_tabstop, (colnr_T)vcol, ci.chr.value).width;
+    if (vcol > MAXCOL) {
+      return NULL;
+    }
+    ci = utfc_next(ci);
+  }
+
+  cl->buf = buf->handle;
+  cl->lnum = lnum;
+  cl->changedtick = changedtick;
+  cl->line = line;
+  cl->len = len;
+  cl->generation = vcol_cache_generation;
+  cl->ts = buf->b_p_ts;
+  cl->use_tabstop = use_tabstop;
+  cl->border = border;
+  cl->width1 = width1;
+  cl->width2 = width2;
+  cl->width = (int)vcol;
+  return cl;
+}
+
+/// Find the last checkpoint of "cl" at or before byte index "col".
+static VcolCheckpoint vcol_cache_seek(const VcolCacheLine *cl, colnr_T col)
+{
+  size_t i = MIN((size_t)col / VCOL_CHECKPOINT_BYTES, kv_size(cl->checkpoints) - 1);
+  // A checkpoint is at the first character starting in its block of bytes,
+  // which may be after "col", or there may be no character in a block.
+  while (i > 0 && kv_A(cl->checkpoints, i).col > col) {
+    i--;
+  }
+  return kv_A(cl->checkpoints, i);
+}
+
+/// Find the character of line "lnum" of "csarg->win" closest before virtual
+/// column "vcol" that can be found without measuring the line from its start.
+/// Used to skip the part of a very long line left of the window.
+///
+/// Can only be used when CSType is kCharsizeFast.
+///
+/// @return  byte index and virtual column of the character, both zero when
+///          the line is too short to be cached.
+VcolCheckpoint vcol_cache_find_vcol(CharsizeArg const *const csarg, linenr_T lnum, colnr_T vcol)
+{
+  VcolCacheLine *cl = vcol_cache_get(csarg->win, lnum, csarg->line, csarg->use_tabstop);
+  if (cl == NULL || vcol <= 0) {
+    return (VcolCheckpoint){ 0 };
+  }
+  // Binary search for the last checkpoint before "vcol".
+  size_t lo = 0;
+  size_t hi = kv_size(cl->checkpoints);
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (kv_A(cl->checkpoints, mid).vcol < vcol) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return kv_A(cl->checkpoints, lo);
+}
+
 /// Get how many virtual columns inline virtual text should offset the cursor.
 ///
 /// @param csarg   should contain information stored by charsize_regular()
@@ -534,6 +685,12 @@ void getvcol(win_T *wp, pos_T *pos, colnr_T *start, colnr_T *cursor, colnr_T *en
   StrCharInfo ci = utf_ptr2StrCharInfo(line);
   if (cstype == kCharsizeFast) {
     bool const use_tabstop = csarg.use_tabstop;
+    VcolCacheLine *cl = vcol_cache_get(wp, pos->lnum, line, use_tabstop);
+    if (cl != NULL) {
+      VcolCheckpoint const cp = vcol_cache_seek(cl, end_col);
+      ci = utf_ptr2StrCharInfo(line + cp.col);
+      vcol = cp.vcol;
+    }
     while (true) {
       if (*ci.ptr == NUL) {
         // if cursor is at NUL, it is treated like 1 cell char
@@ -793,7 +950,7 @@ int plines_win_nofold(win_T *wp, linenr_T lnum)
 
   int64_t col;
   if (cstype == kCharsizeFast) {
-    col = linesize_fast(&csarg, 0, MAXCOL);
+    col = linesize_fast_lnum(&csarg, lnum);
   } else {
     col = linesize_regular(&csarg, 0, MAXCOL);
   }
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <inttypes.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -7,6 +8,7 @@
 #include <string.h>
 #include <uv.h>
 
+#include "klib/kvec.h"
 #include "nvim/ascii_defs.h"
 #include "nvim/charset.h"
 #include "nvim/cmdexpand_defs.h"
@@ -23,6 +25,9 @@
 #include "nvim/hashtab.h"
 #include "nvim/hashtab_defs.h"
 #include "nvim/keycodes.h"
+#include "nvim/lua/executor.h"
+#include "nvim/macros_defs.h"
+#include "nvim/map_defs.h"
 #include "nvim/memory.h"
 #include "nvim/message.h"
 #include "nvim/os/fs.h"
@@ -47,6 +52,22 @@ typedef struct {
 static proftime_T prof_wait_time;
 static char *startuptime_buf = NULL;  // --startuptime buffer
 
+/// --startuptime report in Chrome Trace Event Format, see time_init(). Events
+/// are collected here and written to "time_fd" at once by time_finish().
+static bool time_trace = false;
+static garray_T time_trace_ga = GA_EMPTY_INIT_VALUE;
+/// For every level of time_push() nesting: time of the last message without a
+/// start time, a trace span for the next one starts there.
+static kvec_t(proftime_T) time_trace_marks = KV_INITIAL_VALUE;
+
+/// ":profile sample": a sample is due every PROF_SAMPLE_INTERVAL nanoseconds,
+/// the main thread takes it at the next safe point, see prof_sample_due().
+/// Samples are counted per folded stack.
+enum { PROF_SAMPLE_INTERVAL = 1000000, };
+static char *prof_sample_fname = NULL;
+static bool prof_sample_paused = false;
+static Map(cstr_t, int) prof_samples = MAP_INIT;
+
 /// Gets the current time.
 ///
 /// @return the current time
@@ -299,24 +320,37 @@ void ex_profile(exarg_T *eap)
     do_profiling = PROF_YES;
     profile_set_wait(profile_zero());
     set_vim_var_nr(VV_PROFILING, 1);
-  } else if (do_profiling == PROF_NONE) {
+  } else if (len == 6 && strncmp(eap->arg, "sample", 6) == 0 && *e != NUL) {
+    prof_sample_start(e);
+  } else if (do_profiling == PROF_NONE && prof_sample_fname == NULL) {
     emsg(_("E750: First use \":profile start {fname}\""));
   } else if (strcmp(eap->arg, "stop") == 0) {
     profile_dump();
-    do_profiling = PROF_NONE;
-    set_vim_var_nr(VV_PROFILING, 0);
-    profile_reset();
+    prof_sample_stop();
+    if (do_profiling != PROF_NONE) {
+      do_profiling = PROF_NONE;
+      set_vim_var_nr(VV_PROFILING, 0);
+      profile_reset();
+    }
   } else if (strcmp(eap->arg, "pause") == 0) {
     if (do_profiling == PROF_YES) {
       pause_time = profile_start();
     }
-    do_profiling = PROF_PAUSED;
+    if (do_profiling != PROF_NONE) {
+      do_profiling = PROF_PAUSED;
+    }
+    prof_sample_paused = true;
+    prof_sample_next = 0;
   } else if (strcmp(eap->arg, "continue") == 0) {
     if (do_profiling == PROF_PAUSED) {
       pause_time = profile_end(pause_time);
       profile_set_wait(profile_add(profile_get_wait(), pause_time));
     }
-    do_profiling = PROF_YES;
+    if (do_profiling != PROF_NONE) {
+      do_profiling = PROF_YES;
+    }
+    prof_sample_paused = false;
+    prof_sample_done();
   } else if (strcmp(eap->arg, "dump") == 0) {
     profile_dump();
   } else {
@@ -337,6 +371,7 @@ static char *pexpand_cmds[] = {
   "file",
   "func",
   "pause",
+  "sample",
   "start",
   "stop",
   NULL
@@ -369,6 +404,7 @@ void set_context_in_profile_cmd(expand_T *xp, const char *arg)
   }
 
   if ((end_subcmd - arg == 5 && strncmp(arg, "start", 5) == 0)
+      || (end_subcmd - arg == 6 && strncmp(arg, "sample", 6) == 0)
       || (end_subcmd - arg == 4 && strncmp(arg, "file", 4) == 0)) {
     xp->xp_context = EXPAND_FILES;
     xp->xp_pattern = skipwhite(end_subcmd);
@@ -382,6 +418,169 @@ void set_context_in_profile_cmd(expand_T *xp, const char *arg)
   xp->xp_context = EXPAND_NOTHING;
 }
 
+/// ":profile sample {fname}": start sampling the stack about 1000 times per
+/// second.  Collected stacks are written to "fname" by prof_sample_dump().
+static void prof_sample_start(const char *fname)
+{
+  xfree(prof_sample_fname);
+  prof_sample_fname = expand_env_save_opt(fname, true);
+  prof_sample_paused = false;
+  nlua_sample_start();
+  prof_sample_done();
+}
+
+/// Stop sampling and forget the collected stacks.  Does not write them, use
+/// prof_sample_dump() for that.
+void prof_sample_stop(void)
+{
+  prof_sample_next = 0;
+  nlua_sample_stop();
+
+  const char *key;
+  int count;
+  map_foreach(&prof_samples, key, count, {
+    (void)count;
+    xfree((char *)key);
+  });
+  map_destroy(cstr_t, &prof_samples);
+  XFREE_CLEAR(prof_sample_fname);
+}
+
+/// Append "name" to a frame of the folded stack in "gap".  The ';' separator
+/// cannot appear in a frame name and a line break would end the record.
+static void prof_sample_append(garray_T *gap, const char *name)
+{
+  for (const char *p = name; *p != NUL; p++) {
+    ga_append(gap, *p == ';' ? ',' : (*p == '\n' || *p == '\r') ? ' ' : *p);
+  }
+}
+
+/// Add frame "name" to the folded stack in "gap".
+void prof_sample_frame(garray_T *gap, const char *name)
+{
+  if (gap->ga_len > 0) {
+    ga_append(gap, ';');
+  }
+  prof_sample_append(gap, name);
+}
+
+/// Add the Vimscript execution stack, outermost entry first, to the folded
+/// stack in "gap".
+void prof_sample_estack(garray_T *gap)
+{
+  for (int idx = 0; idx < exestack.ga_len; idx++) {
+    estack_T *entry = ((estack_T *)exestack.ga_data) + idx;
+    if (entry->es_name == NULL || *entry->es_name == NUL) {
+      continue;
+    }
+    switch (entry->es_type) {
+    case ETYPE_SCRIPT:
+      prof_sample_frame(gap, "script "); break;
+    case ETYPE_UFUNC:
+      prof_sample_frame(gap, "function "); break;
+    case ETYPE_AUCMD:
+      prof_sample_frame(gap, "autocmd "); break;
+    default:
+      prof_sample_frame(gap, ""); break;
+    }
+    prof_sample_append(gap, entry->es_name);
+  }
+}
+
+/// Count one sample of the folded stack in "gap" and free it.  Also marks the
+/// pending sample as taken.
+void prof_sample_add(garray_T *gap)
+{
+  if (gap->ga_len == 0) {
+    ga_concat(gap, "[nvim]");
+  }
+  ga_append(gap, NUL);
+
+  cstr_t *key_alloc = NULL;
+  bool new_item = false;
+  int *count = map_put_ref(cstr_t, int)(&prof_samples, gap->ga_data, &key_alloc, &new_item);
+  if (new_item) {
+    *key_alloc = xstrdup(gap->ga_data);
+  }
+  (*count)++;
+  ga_clear(gap);
+}
+
+/// Whether a sample should be taken now.  If so, the next one is due after
+/// another interval.
+bool prof_sample_due(void)
+{
+  if (prof_sample_next == 0) {
+    return false;
+  }
+  uint64_t now = os_hrtime();
+  if (now < prof_sample_next) {
+    return false;
+  }
+  prof_sample_next = now + PROF_SAMPLE_INTERVAL;
+  return true;
+}
+
+/// Take a sample if one is due at a safe point outside of Lua code, see
+/// PROF_SAMPLE_CHECK().  Lua code that is running must have called into
+/// Vimscript, so the Lua stack goes below the Vimscript stack.
+void prof_sample_take(void)
+{
+  if (!prof_sample_due()) {
+    return;
+  }
+  garray_T ga;
+  ga_init(&ga, 1, 200);
+  nlua_sample_frames(&ga);
+  prof_sample_estack(&ga);
+  prof_sample_add(&ga);
+}
+
+/// Start a new interval before the next sample, e.g. after waiting for input,
+/// so that the wait is not counted as the code that runs next.
+void prof_sample_done(void)
+{
+  if (prof_sample_fname == NULL || prof_sample_paused) {
+    return;
+  }
+  prof_sample_next = os_hrtime() + PROF_SAMPLE_INTERVAL;
+}
+
+static int prof_sample_cmp(const void *s1, const void *s2)
+{
+  return strcmp(*(char **)s1, *(char **)s2);
+}
+
+/// Write the stacks collected by ":profile sample" in the "folded" format
+/// used by flame graph tools: one line per stack with the frames separated by
+/// ';' and followed by the number of samples.
+static void prof_sample_dump(void)
+{
+  if (prof_sample_fname == NULL) {
+    return;
+  }
+
+  FILE *fd = os_fopen(prof_sample_fname, "w");
+  if (fd == NULL) {
+    semsg(_(e_notopen), prof_sample_fname);
+    return;
+  }
+
+  size_t n = map_size(&prof_samples);
+  const char **stacks = xmalloc(MAX(n, 1) * sizeof(*stacks));
+  size_t i = 0;
+  const char *key;
+  map_foreach_key(&prof_samples, key, {
+    stacks[i++] = key;
+  });
+  qsort((void *)stacks, n, sizeof(*stacks), prof_sample_cmp);
+  for (i = 0; i < n; i++) {
+    fprintf(fd, "%s %d\n", stacks[i], map_get(cstr_t, int)(&prof_samples, stacks[i]));
+  }
+  xfree(stacks);
+  fclose(fd);
+}
+
 static proftime_T wait_time;
 
 /// Called when starting to wait for the user to type a character.
@@ -768,6 +967,8 @@ static void script_dump_profile(FILE *fd)
 /// Dump the profiling info.
 void profile_dump(void)
 {
+  prof_sample_dump();
+
   if (profile_fname == NULL) {
     return;
   }
@@ -862,6 +1063,10 @@ void time_push(proftime_T *rel, proftime_T *start)
 {
   proftime_T now = profile_start();
 
+  if (time_trace) {
+    kv_push(time_trace_marks, now);
+  }
+
   // subtract the previous time from now, store it in `rel`
   *rel = profile_sub(now, g_prev_time);
   *start = now;
@@ -878,6 +1083,10 @@ void time_push(proftime_T *rel, proftime_T *start)
 void time_pop(proftime_T tp)
 {
   g_prev_time -= tp;
+
+  if (kv_size(time_trace_marks) > 1) {
+    (void)kv_pop(time_trace_marks);
+  }
 }
 
 /// Prints the difference between `then` and `now`.
@@ -904,6 +1113,12 @@ void time_start(const char *message)
   // initialize the global variables
   g_prev_time = g_start_time = profile_start();
 
+  if (time_trace) {
+    kv_push(time_trace_marks, g_start_time);
+    time_msg(message, NULL);
+    return;
+  }
+
   fprintf(time_fd, "\ntimes in msec\n");
   fprintf(time_fd, " clock   self+sourced   self:  sourced script\n");
   fprintf(time_fd, " clock   elapsed:              other lines\n\n");
@@ -923,8 +1138,20 @@ void time_msg(const char *mesg, const proftime_T *start)
     return;
   }
 
-  // print out the difference between `start` (init earlier) and `now`
   proftime_T now = profile_start();
+
+  if (time_trace) {
+    // A message without a start time ends the span since the previous one.
+    proftime_T *mark = &kv_last(time_trace_marks);
+    time_trace_span(mesg, start != NULL ? *start : *mark, now);
+    if (start == NULL) {
+      *mark = now;
+    }
+    g_prev_time = now;
+    return;
+  }
+
+  // print out the difference between `start` (init earlier) and `now`
   time_diff(g_start_time, now);
 
   // if `start` was supplied, print the diff between `start` and `now`
@@ -942,13 +1169,56 @@ void time_msg(const char *mesg, const proftime_T *start)
   fprintf(time_fd, ": %s\n", mesg);
 }
 
+/// Adds a span from `start` to `now` to the --startuptime trace.
+static void time_trace_span(const char *name, proftime_T start, proftime_T now)
+{
+  ga_concat(&time_trace_ga, "{\"name\":\"");
+  for (const char *p = name; *p != NUL; p++) {
+    if (*p == '"' || *p == '\\') {
+      ga_append(&time_trace_ga, '\\');
+      ga_append(&time_trace_ga, *p);
+    } else if ((uint8_t)(*p) < ' ') {
+      char buf[8];
+      snprintf(buf, sizeof buf, "\\u%04x", (uint8_t)(*p));
+      ga_concat(&time_trace_ga, buf);
+    } else {
+      ga_append(&time_trace_ga, *p);
+    }
+  }
+  char buf[128];
+  // Timestamps are in microseconds of the monotonic clock, which all processes
+  // share: the spans of the UI client and the server line up.
+  snprintf(buf, sizeof buf, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%" PRId64
+           ",\"tid\":0},\n", (double)start / 1.0E3, (double)profile_sub(now, start) / 1.0E3,
+           os_get_pid());
+  ga_concat(&time_trace_ga, buf);
+}
+
+/// Adds a span of `name` from `start` until now to the --startuptime trace.
+///
+/// Only for the trace: unlike time_msg() this does not show in the text report.
+void time_span(const char *name, proftime_T start)
+{
+  if (time_fd == NULL || !time_trace) {
+    return;
+  }
+  time_trace_span(name, start, profile_start());
+}
+
 /// Initializes the `time_fd` stream for the --startuptime report.
 ///
+/// When `fname` ends in ".json" the report is a trace in Chrome Trace Event
+/// Format (JSON Array Format) instead of text. The closing "]" is omitted, so
+/// that other Nvim processes can append their events to the file.
+///
 /// @param fname startuptime report file path
 /// @param proc_name name of the current Nvim process to write in the report.
 void time_init(const char *fname, const char *proc_name)
 {
   const size_t bufsize = 8192;  // Big enough for the entire --startuptime report.
+  size_t len = strlen(fname);
+  time_trace = len > 5 && STRICMP(fname + len - 5, ".json") == 0;
+  bool new_file = !os_path_exists(fname);
   time_fd = fopen(fname, "a");
   if (time_fd == NULL) {
     fprintf(stderr, _(e_notopen), fname);
@@ -966,6 +1236,19 @@ void time_init(const char *fname, const char *proc_name)
     fprintf(stderr, "time_init: setvbuf failed: %d %s", r, uv_err_name(r));
     return;
   }
+  if (time_trace) {
+    ga_init(&time_trace_ga, 1, 8192);
+    if (new_file) {
+      ga_concat(&time_trace_ga, "[\n");
+    }
+    char buf[64];
+    snprintf(buf, sizeof buf, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%" PRId64
+             ",\"tid\":0,\"args\":{\"name\":\"", os_get_pid());
+    ga_concat(&time_trace_ga, buf);
+    ga_concat(&time_trace_ga, proc_name);
+    ga_concat(&time_trace_ga, "\"}},\n");
+    return;
+  }
   fprintf(time_fd, "--- Startup times for process: %s ---\n", proc_name);
 }
 
@@ -976,7 +1259,14 @@ void time_finish(void)
     return;
   }
   assert(startuptime_buf != NULL);
-  TIME_MSG("--- NVIM STARTED ---\n");
+  TIME_MSG(time_trace ? "--- NVIM STARTED ---" : "--- NVIM STARTED ---\n");
+
+  if (time_trace) {
+    fwrite(time_trace_ga.ga_data, 1, (size_t)time_trace_ga.ga_len, time_fd);
+    ga_clear(&time_trace_ga);
+    kv_destroy(time_trace_marks);
+    time_trace = false;
+  }
 
   // flush buffer to disk
   fclose(time_fd);
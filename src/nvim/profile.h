@@ -11,4 +11,10 @@
   if (time_fd != NULL) time_msg(s, NULL); \
 } while (0)
 
+/// Take a sample for ":profile sample" if one is due.  Used at safe points
+/// where Vimscript or C code is running.
+#define PROF_SAMPLE_CHECK() do { \
+  if (prof_sample_next != 0) prof_sample_take(); \
+} while (0)
+
 #include "profile.h.generated.h"
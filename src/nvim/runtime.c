@@ -50,10 +50,12 @@
 #include "nvim/option_defs.h"
 #include "nvim/option_vars.h"
 #include "nvim/os/fs.h"
+#include "nvim/os/fs_defs.h"
 #include "nvim/os/input.h"
 #include "nvim/os/os.h"
 #include "nvim/os/os_defs.h"
 #include "nvim/os/stdpaths_defs.h"
+#include "nvim/os/time.h"
 #include "nvim/path.h"
 #include "nvim/pos_defs.h"
 #include "nvim/profile.h"
@@ -100,6 +102,19 @@ typedef struct {
 typedef kvec_t(SearchPathItem) RuntimeSearchPath;
 typedef kvec_t(char *) CharVec;
 
+typedef struct {
+  char *name;
+  bool isdir;  ///< is a directory or a symlink to one
+} RtpIndexEntry;
+
+/// Listing of a directory below a runtime search path entry.
+typedef struct {
+  kvec_t(RtpIndexEntry) entries;  ///< sorted by name with strcmp()
+  bool exists;                    ///< false if the directory could not be read
+  int64_t mtime;                  ///< modification time when listed, -1 if it
+  int64_t mtime_ns;               ///< must be listed again when next used
+} RtpIndexDir;
+
 #include "runtime.c.generated.h"
 
 garray_T exestack = { 0, 0, sizeof(estack_T), 50, NULL };
@@ -292,6 +307,12 @@ static RuntimeSearchPath runtime_search_path;
 static RuntimeSearchPath runtime_search_path_thread;
 static uv_mutex_t runtime_search_path_mutex;
 
+/// Index of files in the runtime search path: listings of directories below its
+/// entries, keyed by full path. A directory is listed when a lookup first walks
+/// through it, and listed again when a later lookup finds it was modified.
+/// Cleared when 'runtimepath' or 'packpath' is set.
+static PMap(cstr_t) rtp_index = MAP_INIT;
+
 void runtime_init(void)
 {
   uv_mutex_init(&runtime_search_path_mutex);
@@ -545,6 +566,281 @@ static void runtime_search_path_unref(RuntimeSearchPath path, const int *ref)
   }
 }
 
+static int rtp_index_entry_cmp(const void *a, const void *b)
+{
+  return strcmp(((const RtpIndexEntry *)a)->name, ((const RtpIndexEntry *)b)->name);
+}
+
+static void rtp_index_dir_clear(RtpIndexDir *dir)
+{
+  for (size_t i = 0; i < kv_size(dir->entries); i++) {
+    xfree(kv_A(dir->entries, i).name);
+  }
+  kv_size(dir->entries) = 0;
+}
+
+/// Read the entries of directory "path" into "dir".
+///
+/// @return false if "path" is not a readable directory.
+static bool rtp_index_scan(RtpIndexDir *dir, const char *path)
+{
+  rtp_index_dir_clear(dir);
+
+  FileInfo file_info;
+  Directory scan;
+  if (!os_fileinfo(path, &file_info) || !os_scandir(&scan, path)) {
+    return false;
+  }
+
+  char buf[MAXPATHL];
+  const char *name;
+  while ((name = os_scandir_next(&scan)) != NULL) {
+    bool isdir = scan.ent.type == UV_DIRENT_DIR;
+    if (!isdir && scan.ent.type != UV_DIRENT_FILE) {
+      // Follow symlinks. Dangling ones are skipped, like path_expand() does.
+      FileInfo link_info;
+      if (snprintf(buf, sizeof buf, "%s%s%s", path, PATHSEPSTR, name) >= (int)sizeof buf
+          || !os_fileinfo(buf, &link_info)) {
+        continue;
+      }
+      isdir = S_ISDIR(link_info.stat.st_mode);
+    }
+    kv_push(dir->entries, ((RtpIndexEntry){ xstrdup(name), isdir }));
+  }
+  os_closedir(&scan);
+
+  qsort(dir->entries.items, kv_size(dir->entries), sizeof(RtpIndexEntry), rtp_index_entry_cmp);
+
+  dir->mtime = file_info.stat.st_mtim.tv_sec;
+  dir->mtime_ns = file_info.stat.st_mtim.tv_nsec;
+  // With coarse timestamps a change later in the same second may not update the
+  // modification time: list the directory again next time.
+  if (dir->mtime >= (int64_t)os_time() - 1) {
+    dir->mtime = -1;
+  }
+  return true;
+}
+
+/// Get the listing of directory "path", reading it when it was not read before
+/// or when the directory changed since.  Files can be created by anything
+/// (jobs, Lua, other programs), so its modification time is checked every time:
+/// a stat() is much cheaper than reading the directory.
+///
+/// @return NULL if "path" is not a readable directory.
+static RtpIndexDir *rtp_index_dir(const char *path)
+{
+  cstr_t *key = NULL;
+  bool new_item = false;
+  RtpIndexDir **ref = (RtpIndexDir **)pmap_put_ref(cstr_t)(&rtp_index, path, &key, &new_item);
+  if (new_item) {
+    *key = xstrdup(path);
+    *ref = xcalloc(1, sizeof(RtpIndexDir));
+  }
+  RtpIndexDir *dir = *ref;
+
+  FileInfo file_info;
+  if (new_item || !dir->exists || dir->mtime < 0
+      || !os_fileinfo(path, &file_info)
+      || file_info.stat.st_mtim.tv_sec != dir->mtime
+      || file_info.stat.st_mtim.tv_nsec != dir->mtime_ns) {
+    dir->exists = rtp_index_scan(dir, path);
+  }
+  return dir->exists ? dir : NULL;
+}
+
+/// Find "name" in the listing "dir". With 'fileignorecase' a name that differs
+/// in case is accepted.
+static RtpIndexEntry *rtp_index_find(RtpIndexDir *dir, const char *name)
+{
+  RtpIndexEntry key = { .name = (char *)name };
+  RtpIndexEntry *entry = kv_size(dir->entries) == 0
+                         ? NULL
+                         : bsearch(&key, dir->entries.items, kv_size(dir->entries),
+                                   sizeof(RtpIndexEntry), rtp_index_entry_cmp);
+  if (entry == NULL && p_fic) {
+    for (size_t i = 0; i < kv_size(dir->entries); i++) {
+      if (path_fnamecmp(kv_A(dir->entries, i).name, name) == 0) {
+        return &kv_A(dir->entries, i);
+      }
+    }
+  }
+  return entry;
+}
+
+/// Check that the relative path "rel" only has plain directory names before
+/// "tail", which can be looked up in the index: not empty, "." or "..".
+static bool rtp_index_plain_path(const char *rel, const char *tail)
+{
+  if (*tail == NUL) {
+    return false;
+  }
+  for (const char *p = rel; p < tail; p++) {
+    const char *end = p;
+    while (!vim_ispathsep(*end)) {
+      end++;
+    }
+    if (end == p || (p[0] == '.' && (end == p + 1 || (p[1] == '.' && end == p + 2)))) {
+      return false;
+    }
+    p = end;
+  }
+  return true;
+}
+
+/// Check that the runtime search path entry "buf[root_len]" is an absolute path
+/// that is used literally when expanding wildcards.
+static bool rtp_index_plain_root(char *buf, size_t root_len)
+{
+  if (root_len < 2 || !path_is_absolute(buf)) {
+    return false;
+  }
+  char save = buf[root_len];
+  buf[root_len] = NUL;
+  bool plain = !path_has_wildcard(buf);
+#ifdef UNIX
+  plain = plain && strchr(buf, '\\') == NULL;
+#endif
+  buf[root_len] = save;
+  return plain;
+}
+
+/// Walk the index from the runtime search path entry "buf[root_len]" down to
+/// the directory of "tail", the last path component of "buf".
+///
+/// @return the listing of that directory, NULL if it does not exist.
+static RtpIndexDir *rtp_index_walk(char *buf, size_t root_len, char *tail)
+{
+  // "buf[root_len - 1]" is the path separator after the entry.
+  char *end = buf + root_len - 1;
+  char save = *end;
+  *end = NUL;
+  RtpIndexDir *dir = rtp_index_dir(buf);
+  *end = save;
+
+  while (dir != NULL && end < tail - 1) {
+    char *name = end + 1;
+    end = name;
+    while (!vim_ispathsep(*end)) {
+      end++;
+    }
+    save = *end;
+    *end = NUL;
+    RtpIndexEntry *entry = rtp_index_find(dir, name);
+    dir = (entry != NULL && entry->isdir) ? rtp_index_dir(buf) : NULL;
+    *end = save;
+  }
+  return dir;
+}
+
+static int rtp_index_pathcmp(const void *a, const void *b)
+{
+  return pathcmp(*(char **)a, *(char **)b, -1);
+}
+
+/// Like gen_expand_wildcards_and_cb() for the single pattern "buf", which starts
+/// with a runtime search path entry of length "root_len", but match it against
+/// the runtime file index instead of reading directories.
+///
+/// @return OK when some files were found, FAIL when none were and NOTDONE when
+///         "buf" is not matched with the index: it is relative, has no
+///         wildcards, or has wildcards other than those path_expand() handles
+///         in the last path component.
+static int rtp_index_expand_and_cb(char *buf, size_t root_len, int flags, bool all,
+                                   DoInRuntimepathCB callback, void *cookie)
+{
+  if (!rtp_index_plain_root(buf, root_len)) {
+    return NOTDONE;
+  }
+  char *rel = buf + root_len;
+  char *tail = rel;
+  bool wild = false;
+  for (char *p = rel; *p != NUL; p++) {
+    if (vim_ispathsep(*p)) {
+      if (wild) {
+        return NOTDONE;
+      }
+      tail = p + 1;
+#ifdef UNIX
+    } else if (vim_strchr("*?[{", (uint8_t)(*p)) != NULL) {
+#else
+    } else if (vim_strchr("*?[", (uint8_t)(*p)) != NULL) {
+#endif
+      wild = true;
+    } else if (vim_strchr("{`'$~\\", (uint8_t)(*p)) != NULL) {
+      return NOTDONE;
+    }
+  }
+  // A literal path is checked with a single stat(), walking the index would
+  // need one for every directory on the way.
+  if (!wild || *tail == '.' || strstr(tail, "**") != NULL
+      || !rtp_index_plain_path(rel, tail)) {
+    return NOTDONE;
+  }
+
+  garray_T ga;
+  ga_init(&ga, (int)sizeof(char *), 10);
+
+  RtpIndexDir *dir = rtp_index_walk(buf, root_len, tail);
+  if (dir != NULL) {
+    char *pat = file_pat_to_reg_pat(tail, NULL, NULL, false);
+    regmatch_T regmatch;
+#if defined(UNIX)
+    regmatch.rm_ic = p_fic;
+#else
+    regmatch.rm_ic = true;  // Always ignore case on Windows.
+#endif
+    regmatch.regprog = pat == NULL ? NULL : vim_regcomp(pat, RE_MAGIC | RE_NOBREAK);
+    xfree(pat);
+
+    const size_t dirlen = (size_t)(tail - buf);
+    for (size_t i = 0; regmatch.regprog != NULL && i < kv_size(dir->entries); i++) {
+      RtpIndexEntry *entry = &kv_A(dir->entries, i);
+      if (entry->name[0] != '.' && (flags & (entry->isdir ? EW_DIR : EW_FILE))
+          && vim_regexec(&regmatch, entry->name, 0)) {
+        const size_t namelen = strlen(entry->name);
+        char *match = xmalloc(dirlen + namelen + 1);
+        memcpy(match, buf, dirlen);
+        memcpy(match + dirlen, entry->name, namelen + 1);
+        GA_APPEND(char *, &ga, match);
+      }
+    }
+    vim_regfree(regmatch.regprog);
+
+    if (ga.ga_len > 1) {
+      qsort(ga.ga_data, (size_t)ga.ga_len, sizeof(char *), rtp_index_pathcmp);
+    }
+  }
+
+  if (GA_EMPTY(&ga)) {
+    ga_clear(&ga);
+    return FAIL;
+  }
+  (*callback)(ga.ga_len, ga.ga_data, all, cookie);
+  ga_clear_strings(&ga);
+  return OK;
+}
+
+static void rtp_index_clear(void)
+{
+  cstr_t path;
+  RtpIndexDir *dir;
+  map_foreach(&rtp_index, path, dir, {
+    rtp_index_dir_clear(dir);
+    kv_destroy(dir->entries);
+    xfree(dir);
+    xfree((char *)path);
+  });
+  map_clear(cstr_t, &rtp_index);
+}
+
+#if defined(EXITFREE)
+void runtime_index_free_all_mem(void)
+{
+  rtp_index_clear();
+  map_destroy(cstr_t, &rtp_index);
+}
+#endif
+
 /// Find the file "name" in all directories in "path" and invoke
 /// "callback(fname, cookie)".
 /// "name" can contain wildcards.
@@ -608,9 +904,15 @@ static int do_in_cached_path(char *name, int flags, DoInRuntimepathCB callback,
                        | ((flags & DIP_DIRFILE) ? (EW_DIR|EW_FILE) : 0)
                        | EW_NOBREAK;
 
-        // Expand wildcards, invoke the callback for each match.
-        char *(pat[]) = { buf };
-        did_one |= gen_expand_wildcards_and_cb(1, pat, ew_flags, do_all, callback, cookie) == OK;
+        // Expand wildcards, invoke the callback for each match. Use the
+        // runtime file index when possible to avoid reading directories.
+        int res = rtp_index_expand_and_cb(buf, (size_t)(tail - buf), ew_flags, do_all,
+                                          callback, cookie);
+        if (res == NOTDONE) {
+          char *(pat[]) = { buf };
+          res = gen_expand_wildcards_and_cb(1, pat, ew_flags, do_all, callback, cookie);
+        }
+        did_one |= res == OK;
       }
     }
   }
@@ -881,6 +1183,8 @@ static RuntimeSearchPath runtime_search_path_build(void)
 const char *did_set_runtimepackpath(optset_T *args)
 {
   runtime_search_path_valid = false;
+  // Don't keep listings of directories that may no longer be searched.
+  rtp_index_clear();
   return NULL;
 }
 
@@ -906,7 +1210,9 @@ void runtime_search_path_validate(void)
     if (!runtime_search_path_ref) {
       runtime_search_path_free(runtime_search_path);
     }
+    proftime_T start_time = time_fd != NULL ? profile_start() : 0;
     runtime_search_path = runtime_search_path_build();
+    time_span("building runtime search path", start_time);
     runtime_search_path_valid = true;
     runtime_search_path_ref = NULL;  // initially unowned
     uv_mutex_lock(&runtime_search_path_mutex);
@@ -1294,6 +1600,13 @@ void ex_packloadall(exarg_T *eap)
 void load_plugins(void)
 {
   if (p_lpl) {
+    proftime_T rel_time;
+    proftime_T start_time;
+    FILE *const l_time_fd = time_fd;
+    if (l_time_fd != NULL) {
+      time_push(&rel_time, &start_time);
+    }
+
     char *rtp_copy = p_rtp;
     char *const plugin_pattern = "plugin/**/*";  // NOLINT
 
@@ -1317,6 +1630,11 @@ void load_plugins(void)
 
     source_runtime_vim_lua(plugin_pattern, DIP_ALL | DIP_AFTER);
     TIME_MSG("loading after plugins");
+
+    if (l_time_fd != NULL) {
+      time_msg("loading plugins", &start_time);
+      time_pop(rel_time);
+    }
   }
 }
 
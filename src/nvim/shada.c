@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -24,6 +25,8 @@
 #include "nvim/eval/typval.h"
 #include "nvim/eval/typval_defs.h"
 #include "nvim/eval/vars.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/multiqueue.h"
 #include "nvim/ex_cmds.h"
 #include "nvim/ex_cmds_defs.h"
 #include "nvim/ex_docmd.h"
@@ -33,6 +36,7 @@
 #include "nvim/hashtab.h"
 #include "nvim/hashtab_defs.h"
 #include "nvim/macros_defs.h"
+#include "nvim/main.h"
 #include "nvim/map_defs.h"
 #include "nvim/mark.h"
 #include "nvim/mark_defs.h"
@@ -56,6 +60,7 @@
 #include "nvim/os/time_defs.h"
 #include "nvim/path.h"
 #include "nvim/pos_defs.h"
+#include "nvim/profile.h"
 #include "nvim/regexp.h"
 #include "nvim/register.h"
 #include "nvim/search.h"
@@ -558,6 +563,95 @@ static ShaDaReadResult sd_reader_skip(FileDescriptor *const sd_reader, const siz
   return kSDReadStatusSuccess;
 }
 
+/// Local marks and change lists read from the default ShaDa file, packed per
+/// file name, so that the marks of a buffer loaded later can be read without
+/// parsing the whole file again.
+static struct {
+  bool valid;          ///< All entries of "fname" were indexed.
+  char *fname;         ///< Name of the indexed ShaDa file.
+  FileInfo info;       ///< File information of "fname" when it was indexed.
+  PMap(cstr_t) marks;  ///< File name -> PackerBuffer with its entries.
+} shada_index = { .marks = MAP_INIT };
+
+/// Forget all indexed local marks.
+static void shada_index_clear(void)
+{
+  const char *key;
+  PackerBuffer *packer;
+  map_foreach(&shada_index.marks, key, packer, {
+    xfree((char *)key);
+    xfree(packer->startptr);
+    xfree(packer);
+  });
+  map_destroy(cstr_t, &shada_index.marks);
+  XFREE_CLEAR(shada_index.fname);
+  shada_index.valid = false;
+}
+
+/// Add a local mark or change list entry to the index.
+static void shada_index_add(const ShadaEntry entry)
+{
+  cstr_t *key_alloc = NULL;
+  bool new_item = false;
+  PackerBuffer **ref = (PackerBuffer **)pmap_put_ref(cstr_t)(&shada_index.marks,
+                                                              entry.data.filemark.fname,
+                                                              &key_alloc, &new_item);
+  if (new_item) {
+    *key_alloc = xstrdup(entry.data.filemark.fname);
+    *ref = xmalloc(sizeof(**ref));
+    **ref = packer_string_buffer();
+  }
+  if (shada_pack_entry(*ref, entry, 0) == kSDWriteFailed) {
+    shada_index.valid = false;
+  }
+}
+
+/// Read the marks of "buf" from the index built when the default ShaDa file
+/// was last read.
+///
+/// @return false if there is no index or the file was changed since.
+static bool shada_index_read_marks(buf_T *buf)
+{
+  if (!shada_index.valid) {
+    return false;
+  }
+  char *const fname = shada_filename(NULL);
+  FileInfo info;
+  const bool unchanged = fname != NULL && strequal(fname, shada_index.fname)
+                         && os_fileinfo(fname, &info)
+                         && os_fileinfo_id_equal(&info, &shada_index.info)
+                         && info.stat.st_size == shada_index.info.stat.st_size
+                         && info.stat.st_mtim.tv_sec == shada_index.info.stat.st_mtim.tv_sec
+                         && info.stat.st_mtim.tv_nsec == shada_index.info.stat.st_mtim.tv_nsec;
+  xfree(fname);
+  if (!unchanged) {
+    return false;
+  }
+
+  // File names must match like in find_buffer(), which may ignore case or
+  // the kind of path separator.
+#ifdef BACKSLASH_IN_FILENAME
+  const bool exact = false;
+#else
+  const bool exact = !p_fic;
+#endif
+  PackerBuffer *packer;
+  if (exact) {
+    packer = pmap_get(cstr_t)(&shada_index.marks, buf->b_ffname);
+    if (packer != NULL) {
+      shada_read_string(packer_take_string(packer), kShaDaWantMarks);
+    }
+  } else {
+    const char *key;
+    map_foreach(&shada_index.marks, key, packer, {
+      if (path_fnamecmp(key, buf->b_ffname) == 0) {
+        shada_read_string(packer_take_string(packer), kShaDaWantMarks);
+      }
+    });
+  }
+  return true;
+}
+
 /// Wrapper for closing file descriptors
 static void close_file(FileDescriptor *cookie)
 {
@@ -577,11 +671,19 @@ static void close_file(FileDescriptor *cookie)
 static int shada_read_file(const char *const file, const int flags)
   FUNC_ATTR_WARN_UNUSED_RESULT
 {
+  shada_bg_wait();
+
   char *const fname = shada_filename(file);
   if (fname == NULL) {
     return FAIL;
   }
 
+  // Reading the default file replaces the index of local marks.
+  const bool index_marks = (file == NULL || *file == NUL) && (flags & kShaDaWantMarks);
+  if (index_marks) {
+    shada_index_clear();
+  }
+
   FileDescriptor sd_reader;
   int of_ret = file_open(&sd_reader, fname, kFileReadOnly, 0);
 
@@ -604,11 +706,29 @@ static int shada_read_file(const char *const file, const int flags)
     xfree(fname);
     return FAIL;
   }
-  xfree(fname);
 
-  shada_read(&sd_reader, flags);
+  const bool indexed = index_marks && os_fileinfo_fd(sd_reader.fd, &shada_index.info);
+  if (indexed) {
+    shada_index.fname = fname;
+  } else {
+    xfree(fname);
+  }
+
+  proftime_T rel_time;
+  proftime_T start_time;
+  FILE *const l_time_fd = time_fd;
+  if (l_time_fd != NULL) {
+    time_push(&rel_time, &start_time);
+  }
+
+  shada_read(&sd_reader, flags | (indexed ? kShaDaIndexMarks : 0));
   close_file(&sd_reader);
 
+  if (l_time_fd != NULL) {
+    time_msg("reading ShaDa file", &start_time);
+    time_pop(rel_time);
+  }
+
   return OK;
 }
 
@@ -936,6 +1056,11 @@ static void shada_read(FileDescriptor *const sd_reader, const int flags)
     // Nothing to do.
     return;
   }
+  // Local marks can only be indexed when they are read.
+  const bool index_marks = (flags & kShaDaIndexMarks) && (srni_flags & kSDReadChanges);
+  if (flags & kShaDaIndexMarks) {
+    shada_index.valid = index_marks;
+  }
   HistoryMergerState hms[HIST_COUNT];
   if (srni_flags & kSDReadHistory) {
     for (int i = 0; i < HIST_COUNT; i++) {
@@ -961,6 +1086,9 @@ static void shada_read(FileDescriptor *const sd_reader, const int flags)
       abort();
     case kSDReadStatusNotShaDa:
     case kSDReadStatusReadError:
+      if (index_marks) {
+        shada_index.valid = false;
+      }
       goto shada_read_main_cycle_end;
     case kSDReadStatusMalformed:
       continue;
@@ -1154,6 +1282,9 @@ static void shada_read(FileDescriptor *const sd_reader, const int flags)
       break;
     case kSDItemChange:
     case kSDItemLocalMark: {
+      if (index_marks) {
+        shada_index_add(cur_entry);
+      }
       if (get_old_files && !set_has(cstr_t, &oldfiles_set, cur_entry.data.filemark.fname)) {
         char *fname = cur_entry.data.filemark.fname;
         if (want_marks) {
@@ -2217,12 +2348,11 @@ static void flush_file_buffer(PackerBuffer *buffer)
 
 /// Write ShaDa file
 ///
-/// @param[in]  sd_writer  Structure containing file writer definition.
+/// @param[in]  packer     Buffer to pack the entries into, flushed at the end.
 /// @param[in]  sd_reader  Structure containing file reader definition. If it is
 ///                        not NULL then contents of this file will be merged
 ///                        with current Neovim runtime.
-static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
-                                    FileDescriptor *const sd_reader)
+static ShaDaWriteResult shada_write(PackerBuffer *const packer, FileDescriptor *const sd_reader)
   FUNC_ATTR_NONNULL_ARG(1)
 {
   ShaDaWriteResult ret = kSDWriteSuccessful;
@@ -2272,8 +2402,6 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
                                          | (num_marked_files ? kSDReadLocalMarks |
                                             kSDReadChanges : 0));
 
-  PackerBuffer packer = packer_buffer_for_file(sd_writer);
-
   // Set b_last_cursor for all the buffers that have a window.
   //
   // It is needed to correctly save '"' mark on exit. Has a side effect of
@@ -2286,7 +2414,7 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
   find_removable_bufs(&removable_bufs);
 
   // Write header
-  if (shada_pack_entry(&packer, (ShadaEntry) {
+  if (shada_pack_entry(packer, (ShadaEntry) {
     .type = kSDItemHeader,
     .timestamp = os_time(),
     .data = {
@@ -2315,7 +2443,7 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
   // Write buffer list
   if (find_shada_parameter('%') != NULL) {
     ShadaEntry buflist_entry = shada_get_buflist(&removable_bufs);
-    if (shada_pack_entry(&packer, buflist_entry, 0) == kSDWriteFailed) {
+    if (shada_pack_entry(packer, buflist_entry, 0) == kSDWriteFailed) {
       xfree(buflist_entry.data.buffer_list.buffers);
       ret = kSDWriteFailed;
       goto shada_write_exit;
@@ -2365,7 +2493,7 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
       typval_T tgttv;
       tv_copy(&vartv, &tgttv);
       ShaDaWriteResult spe_ret;
-      if ((spe_ret = shada_pack_entry(&packer, (ShadaEntry) {
+      if ((spe_ret = shada_pack_entry(packer, (ShadaEntry) {
         .type = kSDItemVariable,
         .timestamp = cur_timestamp,
         .data = {
@@ -2542,8 +2670,8 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
   }
 
   if (sd_reader != NULL) {
-    const ShaDaWriteResult srww_ret = shada_read_when_writing(sd_reader, srni_flags, max_kbyte, wms,
-                                                              &packer);
+    const ShaDaWriteResult srww_ret =
+      shada_read_when_writing(sd_reader, srni_flags, max_kbyte, wms, packer);
     if (srww_ret != kSDWriteSuccessful) {
       ret = srww_ret;
     }
@@ -2572,7 +2700,7 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
   do { \
     for (size_t i_ = 0; i_ < ARRAY_SIZE(wms_array); i_++) { \
       if ((wms_array)[i_].type != kSDItemMissing) { \
-        if (shada_pack_pfreed_entry(&packer, (wms_array)[i_], max_kbyte) \
+        if (shada_pack_pfreed_entry(packer, (wms_array)[i_], max_kbyte) \
             == kSDWriteFailed) { \
           ret = kSDWriteFailed; \
           goto shada_write_exit; \
@@ -2584,7 +2712,7 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
   PACK_WMS_ARRAY(wms->numbered_marks);
   PACK_WMS_ARRAY(wms->registers);
   for (size_t i = 0; i < wms->jumps_size; i++) {
-    if (shada_pack_pfreed_entry(&packer, wms->jumps[i], max_kbyte)
+    if (shada_pack_pfreed_entry(packer, wms->jumps[i], max_kbyte)
         == kSDWriteFailed) {
       ret = kSDWriteFailed;
       goto shada_write_exit;
@@ -2593,7 +2721,7 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
 #define PACK_WMS_ENTRY(wms_entry) \
   do { \
     if ((wms_entry).type != kSDItemMissing) { \
-      if (shada_pack_pfreed_entry(&packer, wms_entry, max_kbyte) \
+      if (shada_pack_pfreed_entry(packer, wms_entry, max_kbyte) \
           == kSDWriteFailed) { \
         ret = kSDWriteFailed; \
         goto shada_write_exit; \
@@ -2619,14 +2747,14 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
   for (size_t i = 0; i < file_markss_to_dump; i++) {
     PACK_WMS_ARRAY(all_file_markss[i]->marks);
     for (size_t j = 0; j < all_file_markss[i]->changes_size; j++) {
-      if (shada_pack_pfreed_entry(&packer, all_file_markss[i]->changes[j],
+      if (shada_pack_pfreed_entry(packer, all_file_markss[i]->changes[j],
                                   max_kbyte) == kSDWriteFailed) {
         ret = kSDWriteFailed;
         goto shada_write_exit;
       }
     }
     for (size_t j = 0; j < all_file_markss[i]->additional_marks_size; j++) {
-      if (shada_pack_entry(&packer, all_file_markss[i]->additional_marks[j],
+      if (shada_pack_entry(packer, all_file_markss[i]->additional_marks[j],
                            0) == kSDWriteFailed) {
         shada_free_shada_entry(&all_file_markss[i]->additional_marks[j]);
         ret = kSDWriteFailed;
@@ -2644,7 +2772,7 @@ static ShaDaWriteResult shada_write(FileDescriptor *const sd_writer,
       if (dump_one_history[i]) {
         hms_insert_whole_neovim_history(&wms->hms[i]);
         HMS_ITER(&wms->hms[i], cur_entry, {
-          if (shada_pack_pfreed_entry(&packer, cur_entry->data, max_kbyte) == kSDWriteFailed) {
+          if (shada_pack_pfreed_entry(packer, cur_entry->data, max_kbyte) == kSDWriteFailed) {
             ret = kSDWriteFailed;
             break;
           }
@@ -2669,7 +2797,7 @@ shada_write_exit:
   })
   map_destroy(cstr_t, &wms->file_marks);
   set_destroy(ptr_t, &removable_bufs);
-  packer.packer_flush(&packer);
+  packer->packer_flush(packer);
   set_destroy(cstr_t, &wms->dumped_variables);
   xfree(wms);
   return ret;
@@ -2677,6 +2805,99 @@ shada_write_exit:
 
 #undef PACK_KEY
 
+/// Open a new temporary file next to ShaDa file "fname", to write the merged
+/// file to before renaming it over "fname".
+///
+/// @param[out]  tempname  Name of the temporary file, to be freed by the
+///                        caller.  NULL if no name could be made for it.
+///
+/// @return File descriptor or a negative libuv error code.  Errors are
+///         reported, except when "*tempname" is NULL.
+static int shada_open_tempfile(const char *const fname, char **const tempname)
+{
+  *tempname = modname(fname, ".tmp.a", false);
+  if (*tempname == NULL) {
+    return UV_EINVAL;
+  }
+
+  // Save permissions from the original file, with modifications:
+  int perm = (int)os_getperm(fname);
+  perm = (perm >= 0) ? ((perm & 0777) | 0600) : 0600;
+  //                 ^3         ^1       ^2      ^2,3
+  // 1: Strip SUID bit if any.
+  // 2: Make sure that user can always read and write the result.
+  // 3: If somebody happened to delete the file after it was opened for
+  //    reading use u=rw permissions.
+  int open_flags = O_CREAT|O_EXCL|O_WRONLY;
+#ifdef O_NOFOLLOW
+  open_flags |= O_NOFOLLOW;
+#endif
+  while (true) {
+    const int fd = os_open(*tempname, open_flags, perm);
+    if (fd >= 0) {
+      return fd;
+    }
+    if (fd != UV_EEXIST && fd != UV_ELOOP) {
+      semsg(_(SERR "System error while opening temporary ShaDa file %s "
+              "for writing: %s"), *tempname, os_strerror(fd));
+      return fd;
+    }
+    // File already exists, try another name
+    char *const wp = *tempname + strlen(*tempname) - 1;
+    if (*wp == 'z') {
+      // Tried names from .tmp.a to .tmp.z, all failed. Something must be
+      // wrong then.
+      semsg(_("E138: All %s.tmp.X files exist, cannot write ShaDa file!"),
+            fname);
+      return fd;
+    }
+    (*wp)++;
+  }
+}
+
+/// Check that ShaDa file "fname" may be replaced by the temporary file
+/// "tempname", open as "fd", and give that the owner of "fname".
+///
+/// @return false if it may not, the error was reported.
+static bool shada_check_replace(const char *const fname, const char *const tempname,
+                                const int fd)
+{
+  FileInfo old_info;
+  if (!os_fileinfo(fname, &old_info)
+      || S_ISDIR(old_info.stat.st_mode)
+#ifdef UNIX
+      // For Unix we check the owner of the file.  It's not very nice
+      // to overwrite a user's viminfo file after a "su root", with a
+      // viminfo file that the user can't read.
+      || (getuid() != ROOT_UID
+          && !(old_info.stat.st_uid == getuid()
+               ? (old_info.stat.st_mode & 0200)
+               : (old_info.stat.st_gid == getgid()
+                  ? (old_info.stat.st_mode & 0020)
+                  : (old_info.stat.st_mode & 0002))))
+#endif
+      ) {
+    semsg(_("E137: ShaDa file is not writable: %s"), fname);
+    return false;
+  }
+#ifdef UNIX
+  if (getuid() == ROOT_UID) {
+    if (old_info.stat.st_uid != ROOT_UID
+        || old_info.stat.st_gid != getgid()) {
+      const uv_uid_t old_uid = (uv_uid_t)old_info.stat.st_uid;
+      const uv_gid_t old_gid = (uv_gid_t)old_info.stat.st_gid;
+      const int fchown_ret = os_fchown(fd, old_uid, old_gid);
+      if (fchown_ret != 0) {
+        semsg(_(RNERR "Failed setting uid and gid for file %s: %s"),
+              tempname, os_strerror(fchown_ret));
+        return false;
+      }
+    }
+  }
+#endif
+  return true;
+}
+
 /// Write ShaDa file to a given location
 ///
 /// @param[in]  fname    File to write to. If it is NULL or empty then default
@@ -2686,6 +2907,8 @@ shada_write_exit:
 /// @return OK if writing was successful, FAIL otherwise.
 int shada_write_file(const char *const file, bool nomerge)
 {
+  shada_bg_wait();
+
   char *const fname = shada_filename(file);
   if (fname == NULL) {
     return FAIL;
@@ -2712,45 +2935,12 @@ int shada_write_file(const char *const file, bool nomerge)
     } else {
       did_open_reader = true;
     }
-    tempname = modname(fname, ".tmp.a", false);
+    const int fd = shada_open_tempfile(fname, &tempname);
     if (tempname == NULL) {
       nomerge = true;
       goto shada_write_file_nomerge;
     }
-
-    // Save permissions from the original file, with modifications:
-    int perm = (int)os_getperm(fname);
-    perm = (perm >= 0) ? ((perm & 0777) | 0600) : 0600;
-    //                 ^3         ^1       ^2      ^2,3
-    // 1: Strip SUID bit if any.
-    // 2: Make sure that user can always read and write the result.
-    // 3: If somebody happened to delete the file after it was opened for
-    //    reading use u=rw permissions.
-shada_write_file_open: {}
-    error = file_open(&sd_writer, tempname, kFileCreateOnly|kFileNoSymlink, perm);
-    if (error) {
-      if (error == UV_EEXIST || error == UV_ELOOP) {
-        // File already exists, try another name
-        char *const wp = tempname + strlen(tempname) - 1;
-        if (*wp == 'z') {
-          // Tried names from .tmp.a to .tmp.z, all failed. Something must be
-          // wrong then.
-          semsg(_("E138: All %s.tmp.X files exist, cannot write ShaDa file!"),
-                fname);
-          xfree(fname);
-          xfree(tempname);
-          if (did_open_reader) {
-            close_file(&sd_reader);
-          }
-          return FAIL;
-        }
-        (*wp)++;
-        goto shada_write_file_open;
-      } else {
-        semsg(_(SERR "System error while opening temporary ShaDa file %s "
-                "for writing: %s"), tempname, os_strerror(error));
-      }
-    } else {
+    if (fd >= 0 && file_open_fd(&sd_writer, fd, kFileCreateOnly) == 0) {
       did_open_writer = true;
     }
   }
@@ -2798,7 +2988,8 @@ shada_write_file_nomerge: {}
     verbose_leave();
   }
 
-  const ShaDaWriteResult sw_ret = shada_write(&sd_writer, (nomerge ? NULL : &sd_reader));
+  PackerBuffer packer = packer_buffer_for_file(&sd_writer);
+  const ShaDaWriteResult sw_ret = shada_write(&packer, (nomerge ? NULL : &sd_reader));
   assert(sw_ret != kSDWriteIgnError);
   if (!nomerge) {
     if (did_open_reader) {
@@ -2806,40 +2997,9 @@ shada_write_file_nomerge: {}
     }
     bool did_remove = false;
     if (sw_ret == kSDWriteSuccessful) {
-      FileInfo old_info;
-      if (!os_fileinfo(fname, &old_info)
-          || S_ISDIR(old_info.stat.st_mode)
-#ifdef UNIX
-          // For Unix we check the owner of the file.  It's not very nice
-          // to overwrite a user's viminfo file after a "su root", with a
-          // viminfo file that the user can't read.
-          || (getuid() != ROOT_UID
-              && !(old_info.stat.st_uid == getuid()
-                   ? (old_info.stat.st_mode & 0200)
-                   : (old_info.stat.st_gid == getgid()
-                      ? (old_info.stat.st_mode & 0020)
-                      : (old_info.stat.st_mode & 0002))))
-#endif
-          ) {
-        semsg(_("E137: ShaDa file is not writable: %s"), fname);
+      if (!shada_check_replace(fname, tempname, file_fd(&sd_writer))) {
         goto shada_write_file_did_not_remove;
       }
-#ifdef UNIX
-      if (getuid() == ROOT_UID) {
-        if (old_info.stat.st_uid != ROOT_UID
-            || old_info.stat.st_gid != getgid()) {
-          const uv_uid_t old_uid = (uv_uid_t)old_info.stat.st_uid;
-          const uv_gid_t old_gid = (uv_gid_t)old_info.stat.st_gid;
-          const int fchown_ret = os_fchown(file_fd(&sd_writer),
-                                           old_uid, old_gid);
-          if (fchown_ret != 0) {
-            semsg(_(RNERR "Failed setting uid and gid for file %s: %s"),
-                  tempname, os_strerror(fchown_ret));
-            goto shada_write_file_did_not_remove;
-          }
-        }
-      }
-#endif
       if (vim_rename(tempname, fname) == -1) {
         semsg(_(RNERR "Can't rename ShaDa file from %s to %s!"),
               tempname, fname);
@@ -2869,14 +3029,214 @@ shada_write_file_did_not_remove:
   return OK;
 }
 
-/// Read marks information from ShaDa file
+/// ShaDa file written in the background, see shada_write_file_async().
+typedef struct {
+  uv_work_t req;
+  String data;       ///< Contents of the file.
+  int fd;            ///< Temporary file to write "data" to.
+  char *tempname;    ///< Name of the temporary file.
+  char *fname;       ///< Name of the ShaDa file to rename it to.
+  bool do_fsync;     ///< Call fsync() before renaming.
+  int error;         ///< Error code of the failed operation or 0.
+  const char *what;  ///< Failed operation.
+} ShaDaBgWrite;
+
+/// ShaDa file being written in the background or NULL.
+static ShaDaBgWrite *shada_bg_write = NULL;
+/// Background write that failed and was not reported yet, or NULL.
+static ShaDaBgWrite *shada_bg_failed = NULL;
+
+/// Write ShaDa file like shada_write_file(), but only merge it with the
+/// current file and serialize it in the main thread.  Writing, syncing and
+/// renaming the temporary file is done in a worker thread.
+///
+/// Falls back to shada_write_file() when the file cannot be merged into a
+/// temporary file.
+///
+/// @param[in]  fname  File to write to.  If it is NULL or empty then default
+///                    location is used.
+///
+/// @return OK if writing was started, FAIL otherwise.
+int shada_write_file_async(const char *const file)
+{
+  shada_bg_wait();
+
+  char *const fname = shada_filename(file);
+  if (fname == NULL) {
+    return FAIL;
+  }
+
+  FileDescriptor sd_reader;
+  if (file_open(&sd_reader, fname, kFileReadOnly, 0) != 0) {
+    xfree(fname);
+    return shada_write_file(file, false);
+  }
+  char *tempname;
+  const int fd = shada_open_tempfile(fname, &tempname);
+  if (tempname == NULL) {
+    close_file(&sd_reader);
+    xfree(fname);
+    return shada_write_file(file, false);
+  }
+  if (fd < 0 || !shada_check_replace(fname, tempname, fd)) {
+    if (fd >= 0) {
+      os_close(fd);
+      os_remove(tempname);
+    }
+    close_file(&sd_reader);
+    xfree(tempname);
+    xfree(fname);
+    return FAIL;
+  }
+
+  if (p_verbose > 1) {
+    verbose_enter();
+    smsg(0, _("Writing ShaDa file \"%s\" in the background"), fname);
+    verbose_leave();
+  }
+
+  PackerBuffer packer = packer_string_buffer();
+  const ShaDaWriteResult sw_ret = shada_write(&packer, &sd_reader);
+  close_file(&sd_reader);
+  if (sw_ret != kSDWriteSuccessful) {
+    if (sw_ret == kSDWriteReadNotShada) {
+      semsg(_(RNERR "Did not rename %s because %s "
+              "does not look like a ShaDa file"), tempname, fname);
+    } else {
+      semsg(_(RNERR "Did not rename %s to %s because there were errors "
+              "during writing it"), tempname, fname);
+    }
+    os_close(fd);
+    os_remove(tempname);
+    xfree(packer.startptr);
+    xfree(tempname);
+    xfree(fname);
+    return FAIL;
+  }
+
+  ShaDaBgWrite *const job = xcalloc(1, sizeof(*job));
+  job->req.data = job;
+  job->data = packer_take_string(&packer);
+  job->fd = fd;
+  job->tempname = tempname;
+  job->fname = fname;
+  job->do_fsync = p_fs;
+  if (uv_queue_work(&main_loop.uv, &job->req, shada_bg_write_work, shada_bg_write_done) != 0) {
+    shada_bg_write_work(&job->req);
+    shada_bg_write_done(&job->req, 0);
+    return OK;
+  }
+  shada_bg_write = job;
+  return OK;
+}
+
+/// Write and rename a ShaDa file, in a worker thread.
+///
+/// Only uses functions that are safe to call outside the main thread.
+static void shada_bg_write_work(uv_work_t *req)
+{
+  ShaDaBgWrite *const job = req->data;
+  const ptrdiff_t written = os_write(job->fd, job->data.data, job->data.size, false);
+  if (written < 0) {
+    job->error = (int)written;
+    job->what = "write";
+  } else if (job->do_fsync) {
+    uv_fs_t fs_req;
+    job->error = uv_fs_fsync(NULL, &fs_req, job->fd, NULL);
+    uv_fs_req_cleanup(&fs_req);
+    job->what = "fsync";
+  }
+  os_close(job->fd);
+
+  if (job->error == 0) {
+    uv_fs_t fs_req;
+    job->error = uv_fs_rename(NULL, &fs_req, job->tempname, job->fname, NULL);
+    uv_fs_req_cleanup(&fs_req);
+    job->what = "rename";
+  }
+  if (job->error != 0) {
+    os_remove(job->tempname);
+  }
+}
+
+/// Called in the main thread when a ShaDa file was written in the background.
+static void shada_bg_write_done(uv_work_t *req, int status)
+{
+  ShaDaBgWrite *const job = req->data;
+  if (shada_bg_write == job) {
+    shada_bg_write = NULL;
+  }
+  if (job->error != 0) {
+    // Report the error where messages can be given, or in shada_bg_wait()
+    // if that comes first.
+    assert(shada_bg_failed == NULL);
+    shada_bg_failed = job;
+    multiqueue_put(main_loop.events, shada_bg_write_report, NULL);
+  } else {
+    shada_bg_write_free(job);
+  }
+}
+
+static void shada_bg_write_report(void **argv)
+{
+  shada_bg_report_error();
+}
+
+/// Give the error message of a failed background write, if any.
+static void shada_bg_report_error(void)
+{
+  ShaDaBgWrite *const job = shada_bg_failed;
+  if (job == NULL) {
+    return;
+  }
+  shada_bg_failed = NULL;
+  semsg(_(SERR "System error while writing ShaDa file %s in the background (%s): %s"),
+        job->fname, job->what, os_strerror(job->error));
+  shada_bg_write_free(job);
+}
+
+static void shada_bg_write_free(ShaDaBgWrite *job)
+{
+  api_free_string(job->data);
+  xfree(job->tempname);
+  xfree(job->fname);
+  xfree(job);
+}
+
+/// Wait until a ShaDa file being written in the background is written, and
+/// report an error of the write.  Must be done before the file is read or
+/// written again, and before exiting.
+void shada_bg_wait(void)
+{
+  if (shada_bg_write != NULL) {
+    LOOP_PROCESS_EVENTS_UNTIL(&main_loop, NULL, -1, shada_bg_write == NULL);
+  }
+  shada_bg_report_error();
+}
+
+/// Read marks information for the current buffer from ShaDa file
+///
+/// Uses the marks remembered when the file was last read as long as it did
+/// not change since, to avoid parsing the whole file for every buffer.
 ///
 /// @return OK in case of success, FAIL otherwise.
 int shada_read_marks(void)
 {
+  // The index may be about to become outdated.
+  shada_bg_wait();
+  if (curbuf->b_ffname != NULL && shada_index_read_marks(curbuf)) {
+    return OK;
+  }
   return shada_read_file(NULL, kShaDaWantMarks);
 }
 
+#ifdef EXITFREE
+void shada_free_all_mem(void)
+{
+  shada_index_clear();
+}
+#endif
+
 /// Read all information from ShaDa file
 ///
 /// @param[in]  fname    File to write to. If it is NULL or empty then default
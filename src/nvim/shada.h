@@ -9,6 +9,7 @@ typedef enum {
   kShaDaForceit = 4,        ///< Overwrite info already read
   kShaDaGetOldfiles = 8,    ///< Load v:oldfiles.
   kShaDaMissingError = 16,  ///< Error out when os_open returns -ENOENT.
+  kShaDaIndexMarks = 32,    ///< Remember local marks of all files, see shada_read_marks().
 } ShaDaReadFileFlags;
 
 #include "shada.h.generated.h"
@@ -34,6 +34,7 @@
 #include "nvim/option_vars.h"
 #include "nvim/os/os_defs.h"
 #include "nvim/os/time.h"
+#include "nvim/profile.h"
 #include "nvim/state_defs.h"
 #include "nvim/strings.h"
 #include "nvim/ui.h"
@@ -376,6 +377,14 @@ void ui_attach_impl(RemoteUI *ui, uint64_t chanid)
   if (ui_count == MAX_UI_COUNT) {
     abort();
   }
+
+  proftime_T rel_time;
+  proftime_T start_time;
+  FILE *const l_time_fd = time_fd;
+  if (l_time_fd != NULL) {
+    time_push(&rel_time, &start_time);
+  }
+
   if (!ui->ui_ext[kUIMultigrid] && !ui->ui_ext[kUIFloatDebug]
       && !ui_client_channel_id) {
     ui_comp_attach(ui);
@@ -405,6 +414,11 @@ void ui_attach_impl(RemoteUI *ui, uint64_t chanid)
   ui_refresh();
 
   do_autocmd_uienter(chanid, true);
+
+  if (l_time_fd != NULL) {
+    time_msg("attaching UI", &start_time);
+    time_pop(rel_time);
+  }
 }
 
 void ui_detach_impl(RemoteUI *ui, uint64_t chanid)
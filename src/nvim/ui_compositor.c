@@ -54,6 +54,39 @@ static schar_T msg_sep_char = schar_from_ascii(' ');
 
 static int dbghl_normal, dbghl_clear, dbghl_composed, dbghl_recompose;
 
+// Occupancy map: for each row of the screen, which grid is on top of which
+// span of columns.  compose_line() uses it instead of checking every layer for
+// every span, and compose_changed() compares it with the map from before the
+// layers changed, to only recompose the spans that show something else.
+
+/// Columns of a screen row where the same grid is on top.
+typedef struct {
+  int endcol;         ///< the span ends before this column
+  ScreenGrid *grid;   ///< top grid, NULL if no grid covers the span
+  int grid_row;       ///< position of "grid" when the span was computed
+  int grid_col;
+} CompSpan;
+
+typedef kvec_t(CompSpan) CompSpans;
+
+/// Position and size of a layer, as used for the occupancy map.
+typedef struct {
+  ScreenGrid *grid;
+  int row;
+  int col;
+  int height;
+  int width;
+  bool disabled;
+} LayerGeom;
+
+static CompSpans *occupancy = NULL;  ///< spans of each row of default_grid
+static bool *occupancy_valid = NULL;
+static int occupancy_rows = 0;
+static int occupancy_cols = 0;
+static CompSpans occupancy_scratch = KV_INITIAL_VALUE;
+/// Layers as they were when the occupancy map was last checked.
+static kvec_t(LayerGeom) occupancy_layers = KV_INITIAL_VALUE;
+
 void ui_comp_init(void)
 {
   kv_push(layers, &default_grid);
@@ -66,6 +99,9 @@ void ui_comp_free_all_mem(void)
   kv_destroy(layers);
   xfree(linebuf);
   xfree(attrbuf);
+  occupancy_free();
+  kv_destroy(occupancy_scratch);
+  kv_destroy(occupancy_layers);
 }
 #endif
 
@@ -90,6 +126,7 @@ void ui_comp_detach(RemoteUI *ui)
     XFREE_CLEAR(linebuf);
     XFREE_CLEAR(attrbuf);
     bufsize = 0;
+    occupancy_free();
   }
   ui->composed = false;
 }
@@ -143,11 +180,24 @@ bool ui_comp_put_grid(ScreenGrid *grid, int row, int col, int height, int width,
   bool moved;
   grid->pending_comp_index_update = true;
 
+  // The area that can change: the old and the new position of the grid.
+  int damage_row = row;
+  int damage_endrow = row + MAX(height, grid->rows);
+  int damage_col = col;
+  int damage_endcol = col + MAX(width, grid->cols);
+  if (grid->comp_index != 0) {
+    damage_row = MIN(damage_row, grid->comp_row);
+    damage_endrow = MAX(damage_endrow, grid->comp_row + grid->rows);
+    damage_col = MIN(damage_col, grid->comp_col);
+    damage_endcol = MAX(damage_endcol, grid->comp_col + grid->cols);
+  }
+  bool exact = ui_comp_should_draw() && occupancy_prepare(damage_row, damage_endrow);
+
   grid->comp_height = height;
   grid->comp_width = width;
   if (grid->comp_index != 0) {
     moved = (row != grid->comp_row) || (col != grid->comp_col);
-    if (ui_comp_should_draw()) {
+    if (ui_comp_should_draw() && !exact) {
       // Redraw the area covered by the old position, and is not covered
       // by the new position. Disable the grid so that compose_area() will not
       // use it.
@@ -204,7 +254,11 @@ bool ui_comp_put_grid(ScreenGrid *grid, int row, int col, int height, int width,
     grid->comp_index = insert_at;
     grid->pending_comp_index_update = true;
   }
-  if (moved && valid && ui_comp_should_draw()) {
+  if (exact) {
+    // Unless it is valid and moved, the grid itself is drawn later.
+    compose_changed(damage_row, damage_endrow, damage_col, damage_endcol,
+                    moved && valid ? NULL : grid);
+  } else if (moved && valid && ui_comp_should_draw()) {
     compose_area(grid->comp_row, grid->comp_row + grid->rows,
                  grid->comp_col, grid->comp_col + grid->cols);
   }
@@ -223,6 +277,9 @@ void ui_comp_remove_grid(ScreenGrid *grid)
     curgrid = &default_grid;
   }
 
+  bool exact = ui_comp_should_draw()
+               && occupancy_prepare(grid->comp_row, grid->comp_row + grid->rows);
+
   for (size_t i = grid->comp_index; i < kv_size(layers) - 1; i++) {
     kv_A(layers, i) = kv_A(layers, i + 1);
     kv_A(layers, i)->comp_index = i;
@@ -232,9 +289,13 @@ void ui_comp_remove_grid(ScreenGrid *grid)
   grid->comp_index = 0;
   grid->pending_comp_index_update = true;
 
-  // recompose the area under the grid
-  // inefficient when being overlapped: only draw up to grid->comp_index
-  ui_comp_compose_grid(grid);
+  // recompose the area under the grid, where it was not covered
+  if (exact) {
+    compose_changed(grid->comp_row, grid->comp_row + grid->rows,
+                    grid->comp_col, grid->comp_col + grid->cols, NULL);
+  } else {
+    ui_comp_compose_grid(grid);
+  }
 }
 
 bool ui_comp_set_grid(handle_T handle)
@@ -259,6 +320,8 @@ bool ui_comp_set_grid(handle_T handle)
 void ui_comp_raise_grid(ScreenGrid *grid, size_t new_index)
 {
   size_t old_index = grid->comp_index;
+  bool exact = ui_comp_should_draw()
+               && occupancy_prepare(grid->comp_row, grid->comp_row + grid->rows);
   for (size_t i = old_index; i < new_index; i++) {
     kv_A(layers, i) = kv_A(layers, i + 1);
     kv_A(layers, i)->comp_index = i;
@@ -267,6 +330,11 @@ void ui_comp_raise_grid(ScreenGrid *grid, size_t new_index)
   kv_A(layers, new_index) = grid;
   grid->comp_index = new_index;
   grid->pending_comp_index_update = true;
+  if (exact) {
+    compose_changed(grid->comp_row, grid->comp_row + grid->rows,
+                    grid->comp_col, grid->comp_col + grid->cols, NULL);
+    return;
+  }
   for (size_t i = old_index; i < new_index; i++) {
     ScreenGrid *grid2 = kv_A(layers, i);
     int startcol = MAX(grid->comp_col, grid2->comp_col);
@@ -352,6 +420,182 @@ ScreenGrid *ui_comp_get_grid_at_coord(int row, int col)
   return &default_grid;
 }
 
+/// Checks if the layers changed since the occupancy map was computed, and
+/// invalidates the map if they did.
+static void occupancy_check(void)
+{
+  if (occupancy_rows != default_grid.rows || occupancy == NULL) {
+    occupancy_free();
+    occupancy_rows = default_grid.rows;
+    occupancy = xcalloc((size_t)MAX(occupancy_rows, 1), sizeof(*occupancy));
+    occupancy_valid = xcalloc((size_t)MAX(occupancy_rows, 1), sizeof(*occupancy_valid));
+  }
+
+  bool changed = kv_size(occupancy_layers) != kv_size(layers)
+                 || occupancy_cols != default_grid.cols;
+  occupancy_cols = default_grid.cols;
+  if (kv_max(occupancy_layers) < kv_size(layers)) {
+    kv_resize(occupancy_layers, kv_size(layers));
+  }
+  kv_size(occupancy_layers) = kv_size(layers);
+  for (size_t i = 0; i < kv_size(layers); i++) {
+    ScreenGrid *g = kv_A(layers, i);
+    // compose_line may have been called after a shrinking operation but
+    // before the resize has actually been applied. Therefore, we need to
+    // first check to see if any grids have pending updates to width/height,
+    // to ensure that we don't accidentally put any characters into `linebuf`
+    // that have been invalidated.
+    LayerGeom geom = {
+      .grid = g,
+      .row = g->comp_row,
+      .col = g->comp_col,
+      .height = MIN(g->rows, g->comp_height),
+      .width = MIN(g->cols, g->comp_width),
+      .disabled = g->comp_disabled,
+    };
+    LayerGeom *seen = &kv_A(occupancy_layers, i);
+    if (!changed && seen->grid == geom.grid && seen->row == geom.row && seen->col == geom.col
+        && seen->height == geom.height && seen->width == geom.width
+        && seen->disabled == geom.disabled) {
+      continue;
+    }
+    changed = true;
+    kv_A(occupancy_layers, i) = geom;
+  }
+
+  if (changed) {
+    memset(occupancy_valid, 0, (size_t)occupancy_rows * sizeof(*occupancy_valid));
+  }
+}
+
+/// Computes the spans of "row" from the layers.
+static void occupancy_build(int row, CompSpans *spans)
+{
+  kv_size(*spans) = 0;
+  int col = 0;
+  while (col < default_grid.cols) {
+    ScreenGrid *grid = NULL;
+    int until = 0;
+    for (size_t i = 0; i < kv_size(occupancy_layers); i++) {
+      LayerGeom *g = &kv_A(occupancy_layers, i);
+      if (g->row > row || row >= g->row + g->height || g->disabled) {
+        continue;
+      }
+      if (g->col <= col && col < g->col + g->width) {
+        grid = g->grid;
+        until = g->col + g->width;
+      } else if (g->col > col) {
+        until = MIN(until, g->col);
+      }
+    }
+    if (until <= col) {
+      // Not covered, only when the screen is being resized.
+      grid = NULL;
+      until = default_grid.cols;
+    }
+    until = MIN(until, default_grid.cols);
+    kv_push(*spans, ((CompSpan){ .endcol = until, .grid = grid,
+                                 .grid_row = grid ? grid->comp_row : 0,
+                                 .grid_col = grid ? grid->comp_col : 0 }));
+    col = until;
+  }
+  if (kv_size(*spans) == 0) {
+    kv_push(*spans, ((CompSpan){ .endcol = 0 }));
+  }
+}
+
+/// @return  the spans of "row".  occupancy_check() must have been called.
+static CompSpans *occupancy_row(int row)
+{
+  assert(row >= 0 && row < occupancy_rows);
+  if (!occupancy_valid[row]) {
+    occupancy_build(row, &occupancy[row]);
+    occupancy_valid[row] = true;
+  }
+  return &occupancy[row];
+}
+
+/// Makes sure the occupancy of rows "startrow" to "endrow" (exclusive)
+/// describes the layers before they are changed, so that compose_changed() can
+/// find out what changed.
+///
+/// @return  false if the layers were changed since the last time a grid was
+///          composed on one of the rows, then compose_changed() cannot be used.
+static bool occupancy_prepare(int startrow, int endrow)
+{
+  occupancy_check();
+  bool exact = true;
+  for (int row = MAX(startrow, 0); row < MIN(endrow, occupancy_rows); row++) {
+    exact &= occupancy_valid[row];
+    occupancy_row(row);
+  }
+  return exact;
+}
+
+/// Recomposes the parts of the area that show another grid, or the same grid at
+/// another position, than when occupancy_prepare() was called for its rows.
+/// Parts of the screen that stay covered by the same grid are not recomposed.
+///
+/// @param skip  don't recompose spans where this grid is now on top, it is
+///              going to be drawn later.
+static void compose_changed(int startrow, int endrow, int startcol, int endcol, ScreenGrid *skip)
+{
+  occupancy_check();
+  endrow = MIN(endrow, occupancy_rows);
+  endcol = MIN(endcol, default_grid.cols);
+  startcol = MAX(startcol, 0);
+  for (int row = MAX(startrow, 0); row < endrow; row++) {
+    CompSpans old = occupancy[row];
+    occupancy[row] = occupancy_scratch;
+    occupancy_build(row, &occupancy[row]);
+    occupancy_valid[row] = true;
+    occupancy_scratch = old;
+    assert(kv_size(old) > 0);
+
+    CompSpans *cur = &occupancy[row];
+    size_t old_idx = 0;
+    size_t new_idx = 0;
+    int damage_start = -1;
+    for (int col = startcol; col < endcol;) {
+      while (old_idx < kv_size(old) - 1 && kv_A(old, old_idx).endcol <= col) {
+        old_idx++;
+      }
+      while (new_idx < kv_size(*cur) - 1 && kv_A(*cur, new_idx).endcol <= col) {
+        new_idx++;
+      }
+      CompSpan *o = &kv_A(old, old_idx);
+      CompSpan *s = &kv_A(*cur, new_idx);
+      int until = MIN(MIN(o->endcol, s->endcol), endcol);
+      bool changed = (row == msg_sep_row || o->grid != s->grid
+                      || o->grid_row != s->grid_row || o->grid_col != s->grid_col)
+                     && s->grid != skip && s->grid != NULL;
+      if (changed && damage_start < 0) {
+        damage_start = col;
+      } else if (!changed && damage_start >= 0) {
+        compose_debug(row, row + 1, damage_start, col, dbghl_recompose, true);
+        compose_line(row, damage_start, col, kLineFlagInvalid);
+        damage_start = -1;
+      }
+      col = MAX(until, col + 1);
+    }
+    if (damage_start >= 0) {
+      compose_debug(row, row + 1, damage_start, endcol, dbghl_recompose, true);
+      compose_line(row, damage_start, endcol, kLineFlagInvalid);
+    }
+  }
+}
+
+static void occupancy_free(void)
+{
+  for (int row = 0; row < occupancy_rows; row++) {
+    kv_destroy(occupancy[row]);
+  }
+  XFREE_CLEAR(occupancy);
+  XFREE_CLEAR(occupancy_valid);
+  occupancy_rows = 0;
+  kv_size(occupancy_layers) = 0;
+}
+
 /// Baseline implementation. This is always correct, but we can sometimes
 /// do something more efficient (where efficiency means smaller deltas to
 /// the downstream UI.)
@@ -380,29 +624,16 @@ static void compose_line(Integer row, Integer startcol, Integer endcol, LineFlag
   sattr_T *bg_attrs = &default_grid.attrs[default_grid.line_offset[row]
                                           + (size_t)startcol];
 
+  occupancy_check();
+  CompSpans *spans = occupancy_row((int)row);
+  size_t span_idx = 0;
+
   while (col < endcol) {
-    int until = 0;
-    for (size_t i = 0; i < kv_size(layers); i++) {
-      ScreenGrid *g = kv_A(layers, i);
-      // compose_line may have been called after a shrinking operation but
-      // before the resize has actually been applied. Therefore, we need to
-      // first check to see if any grids have pending updates to width/height,
-      // to ensure that we don't accidentally put any characters into `linebuf`
-      // that have been invalidated.
-      int grid_width = MIN(g->cols, g->comp_width);
-      int grid_height = MIN(g->rows, g->comp_height);
-      if (g->comp_row > row || row >= g->comp_row + grid_height
-          || g->comp_disabled) {
-        continue;
-      }
-      if (g->comp_col <= col && col < g->comp_col + grid_width) {
-        grid = g;
-        until = g->comp_col + grid_width;
-      } else if (g->comp_col > col) {
-        until = MIN(until, g->comp_col);
-      }
+    while (span_idx < kv_size(*spans) - 1 && kv_A(*spans, span_idx).endcol <= col) {
+      span_idx++;
     }
-    until = MIN(until, (int)endcol);
+    grid = kv_A(*spans, span_idx).grid;
+    int until = MIN(kv_A(*spans, span_idx).endcol, (int)endcol);
 
     assert(grid != NULL);
     assert(until > col);
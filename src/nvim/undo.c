@@ -73,6 +73,7 @@
 #include <assert.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -108,6 +109,7 @@
 #include "nvim/globals.h"
 #include "nvim/highlight_defs.h"
 #include "nvim/macros_defs.h"
+#include "nvim/map_defs.h"
 #include "nvim/mark.h"
 #include "nvim/mark_defs.h"
 #include "nvim/mbyte.h"
@@ -133,13 +135,24 @@
 #include "nvim/undo.h"
 #include "nvim/undo_defs.h"
 #include "nvim/vim_defs.h"
+#include "xdiff/xdiff.h"
 
 /// Structure passed around between undofile functions.
 typedef struct {
   buf_T *bi_buf;
   FILE *bi_fp;
+  int bi_version;         ///< version of the undo file being read or written
+  const uint8_t *bi_ptr;  ///< when "bi_fp" is NULL: next byte to read
+  const uint8_t *bi_end;  ///< when "bi_fp" is NULL: end of the data
 } bufinfo_T;
 
+/// State for u_share_hunk().
+typedef struct {
+  garray_T ush_ga;    ///< the u_shared_T found so far
+  linenr_T ush_idx;   ///< index in ue_array after the last changed block
+  linenr_T ush_off;   ///< index in the new text after the last changed block
+} ushare_T;
+
 #include "undo.c.generated.h"
 
 static const char e_undo_list_corrupt[]
@@ -382,6 +395,12 @@ int u_savecommon(buf_T *buf, linenr_T top, linenr_T bot, linenr_T newbot, bool r
   u_entry_T *prev_uep;
   linenr_T size = bot - top - 1;
 
+  // When the undo tree is dropped because the last header can't be decoded
+  // "b_u_synced" is set and a new header is made.
+  if (!buf->b_u_synced) {
+    u_load_entries(buf, buf->b_u_newhead);
+  }
+
   // If curbuf->b_u_synced == true make a new header.
   if (buf->b_u_synced) {
     // Need to create new entry in b_changelist.
@@ -632,7 +651,9 @@ int u_savecommon(buf_T *buf, linenr_T top, linenr_T bot, linenr_T newbot, bool r
 #define UF_ENTRY_END_MAGIC     0x3581
 
 // 2-byte undofile version number
-#define UF_VERSION             3
+#define UF_VERSION             4
+// version without the length of the entries of a header, can still be read
+#define UF_VERSION_NOLEN       3
 
 // extra fields for header
 #define UF_LAST_SAVE_NR        1
@@ -642,6 +663,9 @@ int u_savecommon(buf_T *buf, linenr_T top, linenr_T bot, linenr_T newbot, bool r
 
 static const char e_not_open[] = N_("E828: Cannot open undo file for writing: %s");
 
+// Minimal number of lines in an undo entry for u_share_lines().
+#define UE_SHARE_MIN_LINES     100
+
 /// Compute the hash for a buffer text into hash[UNDO_HASH_SIZE].
 ///
 /// @param[in] buf The buffer used to compute the hash
@@ -772,6 +796,8 @@ static void u_free_uhp(u_header_T *uhp)
     u_freeentry(uep, uep->ue_size);
     uep = nuep;
   }
+  kv_destroy(uhp->uh_extmark);
+  xfree(uhp->uh_data);
   xfree(uhp);
 }
 
@@ -792,7 +818,7 @@ static bool serialize_header(bufinfo_T *bi, uint8_t *hash)
     return false;
   }
 
-  undo_write_bytes(bi, UF_VERSION, 2);
+  undo_write_bytes(bi, (uintmax_t)bi->bi_version, 2);
 
   // Write a hash of the buffer text, so that we can verify it is
   // still the same when reading the buffer text.
@@ -833,6 +859,30 @@ static bool serialize_header(bufinfo_T *bi, uint8_t *hash)
   return true;
 }
 
+/// Returns the number of bytes serialize_uhp() writes for the entries and
+/// extmark undo objects of "uhp".
+static size_t uhp_entries_len(u_header_T *uhp)
+{
+  size_t len = 2 + 2;  // end markers
+  for (u_entry_T *uep = uhp->uh_entry; uep; uep = uep->ue_next) {
+    len += 2 + 5 * 4 + (size_t)uep->ue_nshared * 3 * 4;
+    for (size_t i = 0; i < (size_t)uep->ue_size; i++) {
+      if (uep->ue_array[i] != NULL) {
+        len += 4 + strlen(uep->ue_array[i]);
+      }
+    }
+  }
+  for (size_t i = 0; i < kv_size(uhp->uh_extmark); i++) {
+    UndoObjectType type = kv_A(uhp->uh_extmark, i).type;
+    if (type == kExtmarkSplice) {
+      len += 2 + 4 + sizeof(ExtmarkSplice);
+    } else if (type == kExtmarkMove) {
+      len += 2 + 4 + sizeof(ExtmarkMove);
+    }
+  }
+  return len;
+}
+
 /// Writes an undo header.
 ///
 /// @param bi  The buffer information
@@ -841,6 +891,7 @@ static bool serialize_header(bufinfo_T *bi, uint8_t *hash)
 /// @returns false in case of an error.
 static bool serialize_uhp(bufinfo_T *bi, u_header_T *uhp)
 {
+  assert(bi->bi_version != UF_VERSION_NOLEN || uhp->uh_data == NULL);
   if (!undo_write_bytes(bi, (uintmax_t)UF_HEADER_MAGIC, 2)) {
     return false;
   }
@@ -852,7 +903,7 @@ static bool serialize_uhp(bufinfo_T *bi, u_header_T *uhp)
   undo_write_bytes(bi, (uintmax_t)uhp->uh_seq, 4);
   serialize_pos(bi, uhp->uh_cursor);
   undo_write_bytes(bi, (uintmax_t)uhp->uh_cursor_vcol, 4);
-  undo_write_bytes(bi, (uintmax_t)uhp->uh_flags, 2);
+  undo_write_bytes(bi, (uintmax_t)(uhp->uh_flags & ~UH_SHARED), 2);
   // Assume NMARKS will stay the same.
   for (size_t i = 0; i < (size_t)NMARKS; i++) {
     serialize_pos(bi, uhp->uh_namedm[i].mark);
@@ -870,6 +921,20 @@ static bool serialize_uhp(bufinfo_T *bi, u_header_T *uhp)
   // Write end marker.
   undo_write_bytes(bi, 0, 1);
 
+  // Write the length of the entries, so that reading the file can postpone
+  // decoding them until they are used.  When that did not happen yet, write
+  // the data as it was read.
+  if (bi->bi_version != UF_VERSION_NOLEN) {
+    if (uhp->uh_data != NULL) {
+      return undo_write_bytes(bi, uhp->uh_data_len, 4)
+             && undo_write(bi, uhp->uh_data, uhp->uh_data_len);
+    }
+    size_t len = uhp_entries_len(uhp);
+    if (len > INT32_MAX || !undo_write_bytes(bi, len, 4)) {
+      return false;
+    }
+  }
+
   // Write all the entries.
   for (u_entry_T *uep = uhp->uh_entry; uep; uep = uep->ue_next) {
     undo_write_bytes(bi, (uintmax_t)UF_ENTRY_MAGIC, 2);
@@ -944,7 +1009,53 @@ static u_header_T *unserialize_uhp(bufinfo_T *bi, const char *file_name)
     }
   }
 
-  // Unserialize the uep list.
+  kv_init(uhp->uh_extmark);
+
+  if (bi->bi_version == UF_VERSION_NOLEN) {
+    if (!unserialize_entries(bi, uhp, file_name)) {
+      u_free_uhp(uhp);
+      return NULL;
+    }
+    return uhp;
+  }
+
+  // Keep the entries as they are in the file, they are decoded by
+  // u_load_entries() when used.  Check them now, so that a corrupted file
+  // is still rejected as a whole.
+  int len = undo_read_4c(bi);
+  if (len < 0) {
+    corruption_error("entry length", file_name);
+    u_free_uhp(uhp);
+    return NULL;
+  }
+  uhp->uh_data_len = (size_t)len;
+  uhp->uh_data = xmalloc(uhp->uh_data_len);
+  bufinfo_T data_bi = {
+    .bi_buf = bi->bi_buf,
+    .bi_ptr = uhp->uh_data,
+    .bi_end = uhp->uh_data + uhp->uh_data_len,
+  };
+  if (!undo_read(bi, uhp->uh_data, uhp->uh_data_len)) {
+    corruption_error("truncated", file_name);
+    u_free_uhp(uhp);
+    return NULL;
+  }
+  if (!undo_check_entries(&data_bi, -1)) {
+    corruption_error("entry", file_name);
+    u_free_uhp(uhp);
+    return NULL;
+  }
+
+  return uhp;
+}
+
+/// Unserializes the uep list and the extmark undo objects of "uhp".
+///
+/// @param file_name  Name used in error messages, NULL to not give any.
+///
+/// @returns false in case of an error.
+static bool unserialize_entries(bufinfo_T *bi, u_header_T *uhp, const char *file_name)
+{
   u_entry_T *last_uep = NULL;
   int c;
   while ((c = undo_read_2c(bi)) == UF_ENTRY_MAGIC) {
@@ -957,37 +1068,130 @@ static u_header_T *unserialize_uhp(bufinfo_T *bi, const char *file_name)
     }
     last_uep = uep;
     if (uep == NULL || error) {
-      u_free_uhp(uhp);
-      return NULL;
+      return false;
     }
   }
   if (c != UF_ENTRY_END_MAGIC) {
-    corruption_error("entry end", file_name);
-    u_free_uhp(uhp);
-    return NULL;
+    if (file_name != NULL) {
+      corruption_error("entry end", file_name);
+    }
+    return false;
   }
 
   // Unserialize all extmark undo information
-  kv_init(uhp->uh_extmark);
-
   while ((c = undo_read_2c(bi)) == UF_ENTRY_MAGIC) {
     bool error = false;
     ExtmarkUndoObject *extup = unserialize_extmark(bi, &error, file_name);
     if (error) {
-      kv_destroy(uhp->uh_extmark);
-      xfree(extup);
-      return NULL;
+      return false;
     }
     kv_push(uhp->uh_extmark, *extup);
     xfree(extup);
   }
   if (c != UF_ENTRY_END_MAGIC) {
-    corruption_error("entry end", file_name);
-    u_free_uhp(uhp);
-    return NULL;
+    if (file_name != NULL) {
+      corruption_error("entry end", file_name);
+    }
+    return false;
   }
 
-  return uhp;
+  return true;
+}
+
+/// Checks that the entries and extmark undo objects that "bi" points to can
+/// be unserialized, without allocating them.
+///
+/// @param line_count  When not negative, the number of lines in the buffer.
+///                    The lines that an entry shares with the buffer text
+///                    must then fit in it, after the other entries of the
+///                    header put back their stored lines.  This bounds
+///                    "ue_size" of an entry that stores only a few lines.
+static bool undo_check_entries(bufinfo_T *bi, linenr_T line_count)
+{
+  int64_t stored_total = 0;
+  int64_t shared_max = 0;
+  int c;
+  while ((c = undo_read_2c(bi)) == UF_ENTRY_MAGIC) {
+    // ue_top, ue_bot and ue_lcount
+    for (int i = 0; i < 3; i++) {
+      undo_read_4c(bi);
+    }
+    int size = undo_read_4c(bi);
+    int nshared = undo_read_4c(bi);
+    if (size < 0 || nshared < 0 || nshared > size) {
+      return false;
+    }
+    int stored = size;
+    int next_idx = 0;
+    for (int i = 0; i < nshared; i++) {
+      int idx = undo_read_4c(bi);
+      int off = undo_read_4c(bi);
+      int count = undo_read_4c(bi);
+      if (idx < next_idx || off < 0 || count <= 0 || count > size - idx) {
+        return false;
+      }
+      next_idx = idx + count;
+      stored -= count;
+    }
+    shared_max = MAX(shared_max, size - stored);
+    stored_total += stored;
+    for (int i = 0; i < stored; i++) {
+      int line_len = undo_read_4c(bi);
+      if (line_len < 0 || bi->bi_end - bi->bi_ptr < line_len) {
+        return false;
+      }
+      bi->bi_ptr += line_len;
+    }
+  }
+  if (line_count >= 0 && shared_max > line_count + stored_total) {
+    return false;
+  }
+  if (c != UF_ENTRY_END_MAGIC) {
+    return false;
+  }
+
+  while ((c = undo_read_2c(bi)) == UF_ENTRY_MAGIC) {
+    int type = undo_read_4c(bi);
+    size_t len = type == kExtmarkSplice ? sizeof(ExtmarkSplice)
+                 : type == kExtmarkMove ? sizeof(ExtmarkMove) : 0;
+    if (len == 0 || (size_t)(bi->bi_end - bi->bi_ptr) < len) {
+      return false;
+    }
+    bi->bi_ptr += len;
+  }
+  return c == UF_ENTRY_END_MAGIC && bi->bi_ptr == bi->bi_end;
+}
+
+/// Decodes the entries and extmark undo objects of "uhp" when they were read
+/// from an undo file and not used since.
+///
+/// When the data turns out to be corrupt the whole undo tree of "buf" is
+/// dropped, like when reading the undo file fails.
+///
+/// @return  false when the undo tree was dropped, "uhp" is then invalid.
+static bool u_load_entries(buf_T *buf, u_header_T *uhp)
+{
+  if (uhp == NULL || uhp->uh_data == NULL) {
+    return true;
+  }
+  bufinfo_T bi = {
+    .bi_buf = buf,
+    .bi_version = UF_VERSION,
+    .bi_ptr = uhp->uh_data,
+    .bi_end = uhp->uh_data + uhp->uh_data_len,
+  };
+  // The line count of the buffer is only known now, check the number of
+  // shared lines before unserialize_uep() allocates "ue_array".
+  bufinfo_T check_bi = bi;
+  if (!undo_check_entries(&check_bi, buf->b_ml.ml_line_count)
+      || !unserialize_entries(&bi, uhp, NULL)) {
+    u_clearallandblockfree(buf);
+    emsg(_(e_undo_list_corrupt));
+    return false;
+  }
+  XFREE_CLEAR(uhp->uh_data);
+  uhp->uh_data_len = 0;
+  return true;
 }
 
 static bool serialize_extmark(bufinfo_T *bi, ExtmarkUndoObject extup)
@@ -1062,8 +1266,21 @@ static bool serialize_uep(bufinfo_T *bi, u_entry_T *uep)
   undo_write_bytes(bi, (uintmax_t)uep->ue_bot, 4);
   undo_write_bytes(bi, (uintmax_t)uep->ue_lcount, 4);
   undo_write_bytes(bi, (uintmax_t)uep->ue_size, 4);
+  if (bi->bi_version == UF_VERSION_NOLEN) {
+    assert(uep->ue_nshared == 0);
+  } else {
+    undo_write_bytes(bi, (uintmax_t)uep->ue_nshared, 4);
+  }
+  for (int i = 0; i < uep->ue_nshared; i++) {
+    undo_write_bytes(bi, (uintmax_t)uep->ue_shared[i].us_idx, 4);
+    undo_write_bytes(bi, (uintmax_t)uep->ue_shared[i].us_off, 4);
+    undo_write_bytes(bi, (uintmax_t)uep->ue_shared[i].us_count, 4);
+  }
 
   for (size_t i = 0; i < (size_t)uep->ue_size; i++) {
+    if (uep->ue_array[i] == NULL) {
+      continue;  // in ue_shared
+    }
     size_t len = strlen(uep->ue_array[i]);
     if (!undo_write_bytes(bi, len, 4)) {
       return false;
@@ -1096,14 +1313,51 @@ static u_entry_T *unserialize_uep(bufinfo_T *bi, bool *error, const char *file_n
   }
   uep->ue_array = array;
 
-  for (size_t i = 0; i < (size_t)uep->ue_size; i++) {
+  int nshared = bi->bi_version == UF_VERSION_NOLEN ? 0 : undo_read_4c(bi);
+  if (nshared < 0 || nshared > uep->ue_size) {
+    if (file_name != NULL) {
+      corruption_error("shared lines", file_name);
+    }
+    *error = true;
+    return uep;
+  }
+  if (nshared > 0) {
+    uep->ue_shared = xmalloc(sizeof(u_shared_T) * (size_t)nshared);
+    uep->ue_nshared = nshared;
+  }
+  linenr_T next_idx = 0;
+  for (int i = 0; i < nshared; i++) {
+    u_shared_T *us = &uep->ue_shared[i];
+    us->us_idx = undo_read_4c(bi);
+    us->us_off = undo_read_4c(bi);
+    us->us_count = undo_read_4c(bi);
+    if (us->us_idx < next_idx || us->us_off < 0 || us->us_count <= 0
+        || us->us_count > uep->ue_size - us->us_idx) {
+      if (file_name != NULL) {
+        corruption_error("shared lines", file_name);
+      }
+      *error = true;
+      return uep;
+    }
+    next_idx = us->us_idx + us->us_count;
+  }
+
+  int si = 0;
+  for (linenr_T i = 0; i < uep->ue_size; i++) {
+    if (si < nshared && i == uep->ue_shared[si].us_idx) {
+      // Shared lines are not stored.
+      i += uep->ue_shared[si++].us_count - 1;
+      continue;
+    }
     int line_len = undo_read_4c(bi);
     char *line;
     if (line_len >= 0) {
       line = undo_read_string(bi, (size_t)line_len);
     } else {
       line = NULL;
-      corruption_error("line length", file_name);
+      if (file_name != NULL) {
+        corruption_error("line length", file_name);
+      }
     }
     if (line == NULL) {
       *error = true;
@@ -1159,6 +1413,49 @@ static void unserialize_visualinfo(bufinfo_T *bi, visualinfo_T *info)
 /// @param[in]  buf  Buffer for which undo file is written.
 /// @param[in]  hash  Hash value of the buffer text. Must have #UNDO_HASH_SIZE
 ///                   size.
+/// Returns the next header to visit when walking over the whole undo tree,
+/// starting at the oldest header.  Headers already visited have "mark" in
+/// uh_walk.  Algorithm from undo_time().
+static u_header_T *u_walk_next(u_header_T *uhp, int mark)
+{
+  if (uhp->uh_prev.ptr != NULL && uhp->uh_prev.ptr->uh_walk != mark) {
+    return uhp->uh_prev.ptr;
+  } else if (uhp->uh_alt_next.ptr != NULL
+             && uhp->uh_alt_next.ptr->uh_walk != mark) {
+    return uhp->uh_alt_next.ptr;
+  } else if (uhp->uh_next.ptr != NULL && uhp->uh_alt_prev.ptr == NULL
+             && uhp->uh_next.ptr->uh_walk != mark) {
+    return uhp->uh_next.ptr;
+  } else if (uhp->uh_alt_prev.ptr != NULL) {
+    return uhp->uh_alt_prev.ptr;
+  }
+  return uhp->uh_next.ptr;
+}
+
+/// Returns true when the undo tree of "buf" can only be written with
+/// UF_VERSION: a header was not decoded since it was read, or an entry
+/// shares lines with the text it replaces.
+static bool u_need_entries_len(buf_T *buf)
+{
+  int mark = ++lastmark;
+  u_header_T *uhp = buf->b_u_oldhead;
+  while (uhp != NULL) {
+    if (uhp->uh_walk != mark) {
+      uhp->uh_walk = mark;
+      if (uhp->uh_data != NULL) {
+        return true;
+      }
+      for (u_entry_T *uep = uhp->uh_entry; uep != NULL; uep = uep->ue_next) {
+        if (uep->ue_nshared > 0) {
+          return true;
+        }
+      }
+    }
+    uhp = u_walk_next(uhp, mark);
+  }
+  return false;
+}
+
 void u_write_undo(const char *const name, const bool forceit, buf_T *const buf, uint8_t *const hash)
   FUNC_ATTR_NONNULL_ARG(3, 4)
 {
@@ -1290,10 +1587,12 @@ void u_write_undo(const char *const name, const bool forceit, buf_T *const buf,
   // Undo must be synced.
   u_sync(true);
 
-  // Write the header.
+  // Write the header.  Older versions of Nvim can only read files without
+  // the entries length, only use the new version when it is needed.
   bufinfo_T bi = {
     .bi_buf = buf,
     .bi_fp = fp,
+    .bi_version = u_need_entries_len(buf) ? UF_VERSION : UF_VERSION_NOLEN,
   };
   if (!serialize_header(&bi, hash)) {
     goto write_error;
@@ -1313,21 +1612,7 @@ void u_write_undo(const char *const name, const bool forceit, buf_T *const buf,
         goto write_error;
       }
     }
-
-    // Now walk through the tree - algorithm from undo_time().
-    if (uhp->uh_prev.ptr != NULL && uhp->uh_prev.ptr->uh_walk != mark) {
-      uhp = uhp->uh_prev.ptr;
-    } else if (uhp->uh_alt_next.ptr != NULL
-               && uhp->uh_alt_next.ptr->uh_walk != mark) {
-      uhp = uhp->uh_alt_next.ptr;
-    } else if (uhp->uh_next.ptr != NULL && uhp->uh_alt_prev.ptr == NULL
-               && uhp->uh_next.ptr->uh_walk != mark) {
-      uhp = uhp->uh_next.ptr;
-    } else if (uhp->uh_alt_prev.ptr != NULL) {
-      uhp = uhp->uh_alt_prev.ptr;
-    } else {
-      uhp = uhp->uh_next.ptr;
-    }
+    uhp = u_walk_next(uhp, mark);
   }
 
   if (undo_write_bytes(&bi, (uintmax_t)UF_HEADER_END_MAGIC, 2)) {
@@ -1429,8 +1714,8 @@ void u_read_undo(char *name, const uint8_t *hash, const char *orig_name FUNC_ATT
     semsg(_("E823: Not an undo file: %s"), file_name);
     goto error;
   }
-  int version = get2c(fp);
-  if (version != UF_VERSION) {
+  bi.bi_version = get2c(fp);
+  if (bi.bi_version != UF_VERSION && bi.bi_version != UF_VERSION_NOLEN) {
     semsg(_("E824: Incompatible undo file: %s"), file_name);
     goto error;
   }
@@ -1537,6 +1822,20 @@ void u_read_undo(char *name, const uint8_t *hash, const char *orig_name FUNC_ATT
     goto error;
   }
 
+  // Map each sequence number to the index of its header in uhp_table,
+  // stored plus one, so that zero means not found.
+  Map(int, int) seq_idx = MAP_INIT;
+  for (int i = 0; i < num_head; i++) {
+    bool new_item = false;
+    int *idx = map_put_ref(int, int)(&seq_idx, uhp_table[i]->uh_seq, NULL, &new_item);
+    if (!new_item) {
+      corruption_error("duplicate uh_seq", file_name);
+      map_destroy(int, &seq_idx);
+      goto error;
+    }
+    *idx = i + 1;
+  }
+
 #ifdef U_DEBUG
   size_t amount = num_head * sizeof(int) + 1;
   int *uhp_table_used = xmalloc(amount);
@@ -1545,80 +1844,47 @@ void u_read_undo(char *name, const uint8_t *hash, const char *orig_name FUNC_ATT
 #else
 # define SET_FLAG(j)
 #endif
+#define SEQ_TO_UHP(seq, ptr) \
+  do { \
+    int j_ = map_get(int, int)(&seq_idx, (seq)) - 1; \
+    (ptr) = NULL; \
+    if (j_ >= 0) { \
+      (ptr) = uhp_table[j_]; \
+      SET_FLAG(j_); \
+    } \
+  } while (0)
 
   // We have put all of the headers into a table. Now we iterate through the
   // table and swizzle each sequence number we have stored in uh_*_seq into
   // a pointer corresponding to the header with that sequence number.
-  int16_t old_idx = -1;
-  int16_t new_idx = -1;
-  int16_t cur_idx = -1;
   for (int i = 0; i < num_head; i++) {
     u_header_T *uhp = uhp_table[i];
-    if (uhp == NULL) {
-      continue;
-    }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL && i != j
-          && uhp_table[i]->uh_seq == uhp_table[j]->uh_seq) {
-        corruption_error("duplicate uh_seq", file_name);
-        goto error;
-      }
-    }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL
-          && uhp_table[j]->uh_seq == uhp->uh_next.seq) {
-        uhp->uh_next.ptr = uhp_table[j];
-        SET_FLAG(j);
-        break;
-      }
-    }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL
-          && uhp_table[j]->uh_seq == uhp->uh_prev.seq) {
-        uhp->uh_prev.ptr = uhp_table[j];
-        SET_FLAG(j);
-        break;
-      }
-    }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL
-          && uhp_table[j]->uh_seq == uhp->uh_alt_next.seq) {
-        uhp->uh_alt_next.ptr = uhp_table[j];
-        SET_FLAG(j);
-        break;
-      }
-    }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL
-          && uhp_table[j]->uh_seq == uhp->uh_alt_prev.seq) {
-        uhp->uh_alt_prev.ptr = uhp_table[j];
-        SET_FLAG(j);
-        break;
-      }
-    }
-    if (old_header_seq > 0 && old_idx < 0 && uhp->uh_seq == old_header_seq) {
-      assert(i <= INT16_MAX);
-      old_idx = (int16_t)i;
-      SET_FLAG(i);
-    }
-    if (new_header_seq > 0 && new_idx < 0 && uhp->uh_seq == new_header_seq) {
-      assert(i <= INT16_MAX);
-      new_idx = (int16_t)i;
-      SET_FLAG(i);
-    }
-    if (cur_header_seq > 0 && cur_idx < 0 && uhp->uh_seq == cur_header_seq) {
-      assert(i <= INT16_MAX);
-      cur_idx = (int16_t)i;
-      SET_FLAG(i);
-    }
+    SEQ_TO_UHP(uhp->uh_next.seq, uhp->uh_next.ptr);
+    SEQ_TO_UHP(uhp->uh_prev.seq, uhp->uh_prev.ptr);
+    SEQ_TO_UHP(uhp->uh_alt_next.seq, uhp->uh_alt_next.ptr);
+    SEQ_TO_UHP(uhp->uh_alt_prev.seq, uhp->uh_alt_prev.ptr);
+  }
+  u_header_T *old_uhp = NULL;
+  u_header_T *new_uhp = NULL;
+  u_header_T *cur_uhp = NULL;
+  if (old_header_seq > 0) {
+    SEQ_TO_UHP(old_header_seq, old_uhp);
   }
+  if (new_header_seq > 0) {
+    SEQ_TO_UHP(new_header_seq, new_uhp);
+  }
+  if (cur_header_seq > 0) {
+    SEQ_TO_UHP(cur_header_seq, cur_uhp);
+  }
+#undef SEQ_TO_UHP
+  map_destroy(int, &seq_idx);
 
   // Now that we have read the undo info successfully, free the current undo
   // info and use the info from the file.
   u_blockfree(curbuf);
-  curbuf->b_u_oldhead = old_idx < 0 ? NULL : uhp_table[old_idx];
-  curbuf->b_u_newhead = new_idx < 0 ? NULL : uhp_table[new_idx];
-  curbuf->b_u_curhead = cur_idx < 0 ? NULL : uhp_table[cur_idx];
+  curbuf->b_u_oldhead = old_uhp;
+  curbuf->b_u_newhead = new_uhp;
+  curbuf->b_u_curhead = cur_uhp;
   curbuf->b_u_line_ptr = line_ptr;
   curbuf->b_u_line_lnum = line_lnum;
   curbuf->b_u_line_colnr = line_colnr;
@@ -1710,13 +1976,38 @@ static void put_header_ptr(bufinfo_T *bi, u_header_T *uhp)
   undo_write_bytes(bi, (uint64_t)(uhp != NULL ? uhp->uh_seq : 0), 4);
 }
 
+/// Reads a number of "len" bytes, most significant byte first, from the data
+/// "bi->bi_ptr" points to.
+///
+/// @returns -1 when there are less than "len" bytes left.
+static int undo_read_mem(bufinfo_T *bi, size_t len)
+{
+  if ((size_t)(bi->bi_end - bi->bi_ptr) < len) {
+    bi->bi_ptr = bi->bi_end;
+    return -1;
+  }
+  // Use unsigned rather than int otherwise result is undefined
+  // when left-shift sets the MSB.
+  unsigned n = 0;
+  for (size_t i = 0; i < len; i++) {
+    n = (n << 8) + *bi->bi_ptr++;
+  }
+  return (int)n;
+}
+
 static int undo_read_4c(bufinfo_T *bi)
 {
+  if (bi->bi_fp == NULL) {
+    return undo_read_mem(bi, 4);
+  }
   return get4c(bi->bi_fp);
 }
 
 static int undo_read_2c(bufinfo_T *bi)
 {
+  if (bi->bi_fp == NULL) {
+    return undo_read_mem(bi, 2);
+  }
   return get2c(bi->bi_fp);
 }
 
@@ -1740,7 +2031,16 @@ static time_t undo_read_time(bufinfo_T *bi)
 static bool undo_read(bufinfo_T *bi, uint8_t *buffer, size_t size)
   FUNC_ATTR_NONNULL_ARG(1)
 {
-  const bool retval = fread(buffer, size, 1, bi->bi_fp) == 1;
+  bool retval;
+  if (bi->bi_fp == NULL) {
+    retval = (size_t)(bi->bi_end - bi->bi_ptr) >= size;
+    if (retval) {
+      memcpy(buffer, bi->bi_ptr, size);
+      bi->bi_ptr += size;
+    }
+  } else {
+    retval = fread(buffer, size, 1, bi->bi_fp) == 1;
+  }
   if (!retval) {
     // Error may be checked for only later.  Fill with zeros,
     // so that the reader won't use garbage.
@@ -1885,7 +2185,9 @@ static void u_doit(int startcount, bool quiet, bool do_buf_event)
         break;
       }
 
-      u_undoredo(true, do_buf_event);
+      if (!u_undoredo(true, do_buf_event)) {
+        return;
+      }
     } else {
       if (curbuf->b_u_curhead == NULL || get_undolevel(curbuf) <= 0) {
         beep_flush();  // nothing to redo
@@ -1896,7 +2198,9 @@ static void u_doit(int startcount, bool quiet, bool do_buf_event)
         break;
       }
 
-      u_undoredo(false, do_buf_event);
+      if (!u_undoredo(false, do_buf_event)) {
+        return;
+      }
 
       // Advance for next redo.  Set "newhead" when at the end of the
       // redoable changes.
@@ -2147,7 +2451,9 @@ target_zero:
         break;
       }
       curbuf->b_u_curhead = uhp;
-      u_undoredo(true, true);
+      if (!u_undoredo(true, true)) {
+        return;
+      }
       if (target > 0) {
         uhp->uh_walk = nomark;          // don't go back down here
       }
@@ -2212,7 +2518,9 @@ target_zero:
           break;
         }
 
-        u_undoredo(false, true);
+        if (!u_undoredo(false, true)) {
+          return;
+        }
 
         // Advance "curhead" to below the header we last used.  If it
         // becomes NULL then we need to set "newhead" to this leaf.
@@ -2246,7 +2554,9 @@ target_zero:
 ///
 /// @param undo If `true`, go up the tree. Down if `false`.
 /// @param do_buf_event If `true`, send buffer updates.
-static void u_undoredo(bool undo, bool do_buf_event)
+///
+/// @return  false when the undo tree was dropped because it is corrupt.
+static bool u_undoredo(bool undo, bool do_buf_event)
 {
   char **newarray = NULL;
   linenr_T newlnum = MAXLNUM;
@@ -2256,6 +2566,10 @@ static void u_undoredo(bool undo, bool do_buf_event)
   fmark_T namedm[NMARKS];
   u_header_T *curhead = curbuf->b_u_curhead;
 
+  if (!u_load_entries(curbuf, curhead)) {
+    return false;
+  }
+
   // Don't want autocommands using the undo structures here, they are
   // invalid till the end.
   block_autocmds();
@@ -2266,7 +2580,7 @@ static void u_undoredo(bool undo, bool do_buf_event)
   int old_flags = curhead->uh_flags;
   int new_flags = (curbuf->b_changed ? UH_CHANGED : 0)
                   | ((curbuf->b_ml.ml_flags & ML_EMPTY) ? UH_EMPTYBUF : 0)
-                  | (old_flags & UH_RELOAD);
+                  | (old_flags & (UH_RELOAD | UH_SHARED));
   setpcmark();
 
   // save marks before undo/redo
@@ -2285,16 +2599,25 @@ static void u_undoredo(bool undo, bool do_buf_event)
       bot = curbuf->b_ml.ml_line_count + 1;
     }
     if (top > curbuf->b_ml.ml_line_count || top >= bot
-        || bot > curbuf->b_ml.ml_line_count + 1) {
+        || bot > curbuf->b_ml.ml_line_count + 1
+        || !u_shared_fits(uep, bot - top - 1)) {
       unblock_autocmds();
       iemsg(_("E438: u_undo: line numbers wrong"));
       changed(curbuf);                // don't want UNCHANGED now
-      return;
+      return true;
     }
 
     linenr_T oldsize = bot - top - 1;        // number of lines before undo
     linenr_T newsize = uep->ue_size;         // number of lines after undo
 
+    // Get the lines that were not stored from the text they replace.
+    for (int i = 0; i < uep->ue_nshared; i++) {
+      u_shared_T *us = &uep->ue_shared[i];
+      for (linenr_T j = 0; j < us->us_count; j++) {
+        uep->ue_array[us->us_idx + j] = u_save_line(top + 1 + us->us_off + j);
+      }
+    }
+
     // Decide about the cursor position, depending on what text changed.
     // Don't set it yet, it may be invalid if lines are going to be added.
     if (top < newlnum) {
@@ -2397,6 +2720,17 @@ static void u_undoredo(bool undo, bool do_buf_event)
       curbuf->b_op_end.lnum = top + newsize;
     }
 
+    // The same lines are equal when redoing, no need to store them.
+    for (int i = 0; i < uep->ue_nshared; i++) {
+      u_shared_T *us = &uep->ue_shared[i];
+      for (linenr_T j = 0; j < us->us_count; j++) {
+        XFREE_CLEAR(newarray[us->us_off + j]);
+      }
+      linenr_T idx = us->us_idx;
+      us->us_idx = us->us_off;
+      us->us_off = idx;
+    }
+
     u_newcount += newsize;
     u_oldcount += oldsize;
     uep->ue_size = oldsize;
@@ -2526,6 +2860,7 @@ static void u_undoredo(bool undo, bool do_buf_event)
 #ifdef U_DEBUG
   u_check(false);
 #endif
+  return true;
 }
 
 /// If we deleted or added lines, report the number of less/more lines.
@@ -2651,6 +2986,7 @@ void u_sync(bool force)
     curbuf->b_u_synced = true;  // no entries, nothing to do
   } else {
     u_getbot(curbuf);  // compute ue_bot of previous u_save
+    u_share_lines(curbuf, curbuf->b_u_newhead);
     curbuf->b_u_curhead = NULL;
   }
 }
@@ -2770,9 +3106,12 @@ void u_find_first_changed(void)
   if (curbuf->b_u_curhead != NULL || uhp == NULL) {
     return;      // undid something in an autocmd?
   }
+  if (!u_load_entries(curbuf, uhp)) {
+    return;
+  }
   // Check that the last undo block was for the whole file.
   u_entry_T *uep = uhp->uh_entry;
-  if (uep->ue_top != 0 || uep->ue_bot != 0) {
+  if (uep->ue_top != 0 || uep->ue_bot != 0 || uep->ue_nshared > 0) {
     return;
   }
 
@@ -2823,6 +3162,9 @@ static void u_unch_branch(u_header_T *uhp)
 /// If it's not valid, give an error message and return NULL.
 static u_entry_T *u_get_headentry(buf_T *buf)
 {
+  if (!u_load_entries(buf, buf->b_u_newhead)) {
+    return NULL;
+  }
   if (buf->b_u_newhead == NULL || buf->b_u_newhead->uh_entry == NULL) {
     iemsg(_(e_undo_list_corrupt));
     return NULL;
@@ -2860,6 +3202,129 @@ static void u_getbot(buf_T *buf)
   buf->b_u_synced = true;
 }
 
+/// Callback for xdl_diff() in u_share_lines(): the lines before a changed
+/// block are equal.
+static int u_share_hunk(int start_a, int count_a, int start_b, int count_b, void *priv)
+{
+  ushare_T *ush = priv;
+  if (start_a > ush->ush_idx) {
+    GA_APPEND(u_shared_T, &ush->ush_ga, ((u_shared_T){
+      .us_idx = ush->ush_idx,
+      .us_off = ush->ush_off,
+      .us_count = start_a - ush->ush_idx,
+    }));
+  }
+  ush->ush_idx = start_a + count_a;
+  ush->ush_off = start_b + count_b;
+  return 0;
+}
+
+/// Compares the lines saved in the last entry of header "uhp", when it is
+/// large, with the text that replaced them and frees the saved lines that did
+/// not change, so that a command that rewrites many lines but changes a few
+/// does not keep a copy of all of them.  u_undoredo() gets them back from the
+/// buffer.  Called when undo is synced, only once for each header.
+static void u_share_lines(buf_T *buf, u_header_T *uhp)
+{
+  if (uhp == NULL || (uhp->uh_flags & (UH_RELOAD | UH_SHARED))) {
+    return;
+  }
+  uhp->uh_flags |= UH_SHARED;
+  u_entry_T *uep = uhp->uh_entry;
+  if (uep == NULL || uep->ue_size < UE_SHARE_MIN_LINES || uep->ue_nshared > 0) {
+    return;
+  }
+  linenr_T top = uep->ue_top;
+  linenr_T bot = uep->ue_bot == 0 ? buf->b_ml.ml_line_count + 1 : uep->ue_bot;
+  if (bot - top - 1 <= 0) {
+    return;
+  }
+
+  // A NUL in a line is stored as a NL, it would split the line into several
+  // xdiff records and the hunks would not match line indexes.  Don't share
+  // lines then.
+  size_t old_len = 0;
+  for (linenr_T i = 0; i < uep->ue_size; i++) {
+    size_t len = strlen(uep->ue_array[i]);
+    if (memchr(uep->ue_array[i], NL, len) != NULL) {
+      return;
+    }
+    old_len += len + 1;
+  }
+  size_t new_len = 0;
+  for (linenr_T lnum = top + 1; lnum < bot; lnum++) {
+    size_t len = (size_t)ml_get_buf_len(buf, lnum);
+    if (memchr(ml_get_buf(buf, lnum), NL, len) != NULL) {
+      return;
+    }
+    new_len += len + 1;
+  }
+  if (old_len > INT_MAX || new_len > INT_MAX) {
+    return;
+  }
+
+  // Separate the lines with a NL for xdiff.
+  garray_T old_ga;
+  garray_T new_ga;
+  ga_init(&old_ga, 1, (int)old_len);
+  ga_init(&new_ga, 1, (int)new_len);
+  ga_grow(&old_ga, (int)old_len);
+  ga_grow(&new_ga, (int)new_len);
+  for (linenr_T i = 0; i < uep->ue_size; i++) {
+    ga_concat(&old_ga, uep->ue_array[i]);
+    ga_append(&old_ga, NL);
+  }
+  for (linenr_T lnum = top + 1; lnum < bot; lnum++) {
+    ga_concat_len(&new_ga, ml_get_buf(buf, lnum), (size_t)ml_get_buf_len(buf, lnum));
+    ga_append(&new_ga, NL);
+  }
+
+  mmfile_t old_mmfile = { .ptr = old_ga.ga_data, .size = old_ga.ga_len };
+  mmfile_t new_mmfile = { .ptr = new_ga.ga_data, .size = new_ga.ga_len };
+  xpparam_t param;
+  xdemitconf_t emit_cfg;
+  xdemitcb_t emit_cb;
+  CLEAR_FIELD(param);
+  CLEAR_FIELD(emit_cfg);
+  CLEAR_FIELD(emit_cb);
+  ushare_T ush = { 0 };
+  ga_init(&ush.ush_ga, sizeof(u_shared_T), 16);
+  emit_cfg.hunk_func = u_share_hunk;
+  emit_cb.priv = &ush;
+  bool ok = xdl_diff(&old_mmfile, &new_mmfile, &param, &emit_cfg, &emit_cb) >= 0;
+  if (ok) {
+    // The lines after the last changed block.
+    u_share_hunk(uep->ue_size, 0, bot - top - 1, 0, &ush);
+  }
+  ga_clear(&old_ga);
+  ga_clear(&new_ga);
+
+  if (!ok || ush.ush_ga.ga_len == 0) {
+    ga_clear(&ush.ush_ga);
+    return;
+  }
+  uep->ue_shared = ush.ush_ga.ga_data;
+  uep->ue_nshared = ush.ush_ga.ga_len;
+  for (int i = 0; i < uep->ue_nshared; i++) {
+    u_shared_T *us = &uep->ue_shared[i];
+    for (linenr_T j = 0; j < us->us_count; j++) {
+      XFREE_CLEAR(uep->ue_array[us->us_idx + j]);
+    }
+  }
+}
+
+/// Returns true when the lines in "uep->ue_shared" are within the "size"
+/// lines the entry replaces.
+static bool u_shared_fits(u_entry_T *uep, linenr_T size)
+{
+  for (int i = 0; i < uep->ue_nshared; i++) {
+    if (uep->ue_shared[i].us_off + uep->ue_shared[i].us_count > size) {
+      return false;
+    }
+  }
+  return true;
+}
+
 /// Free one header "uhp" and its entry list and adjust the pointers.
 ///
 /// @param uhpp  if not NULL reset when freeing this header
@@ -2947,6 +3412,7 @@ static void u_freeentries(buf_T *buf, u_header_T *uhp, u_header_T **uhpp)
   }
 
   kv_destroy(uhp->uh_extmark);
+  xfree(uhp->uh_data);
 
 #ifdef U_DEBUG
   uhp->uh_magic = 0;
@@ -2962,6 +3428,7 @@ static void u_freeentry(u_entry_T *uep, int n)
     xfree(uep->ue_array[--n]);
   }
   xfree(uep->ue_array);
+  xfree(uep->ue_shared);
 #ifdef U_DEBUG
   uep->ue_magic = 0;
 #endif
@@ -3221,5 +3688,9 @@ u_header_T *u_force_get_undo_header(buf_T *buf)
       }
     }
   }
+  if (!u_load_entries(buf, uhp)) {
+    // The undo tree was dropped, start a new one.
+    return u_force_get_undo_header(buf);
+  }
   return uhp;
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 
 #include "nvim/extmark_defs.h"
@@ -17,14 +19,25 @@ typedef struct {
   colnr_T vi_curswant;  ///< MAXCOL from w_curswant
 } visualinfo_T;
 
+/// Lines of an undo entry that are not stored, because they are equal to
+/// lines of the text the entry replaces when it is undone or redone.
+typedef struct {
+  linenr_T us_idx;    ///< index in ue_array of the first line
+  linenr_T us_off;    ///< index of the equal line after ue_top
+  linenr_T us_count;  ///< number of lines
+} u_shared_T;
+
 typedef struct u_entry u_entry_T;
 struct u_entry {
   u_entry_T *ue_next;  ///< pointer to next entry in list
   linenr_T ue_top;     ///< number of line above undo block
   linenr_T ue_bot;     ///< number of line below undo block
   linenr_T ue_lcount;  ///< linecount when u_save called
-  char **ue_array;     ///< array of lines in undo block
+  char **ue_array;     ///< array of lines in undo block, NULL for the
+                       ///< lines in ue_shared
   linenr_T ue_size;    ///< number of lines in ue_array
+  u_shared_T *ue_shared;  ///< lines not stored in ue_array, sorted
+  int ue_nshared;         ///< number of items in ue_shared
 #ifdef U_DEBUG
   int ue_magic;        ///< magic number to check allocation
 #endif
@@ -62,6 +75,9 @@ struct u_header {
   time_t uh_time;                 ///< timestamp when the change was made
   int uh_save_nr;                 ///< set when the file was saved after the
                                   ///< changes in this block
+  uint8_t *uh_data;               ///< undo file data for uh_entry and
+                                  ///< uh_extmark when not decoded yet
+  size_t uh_data_len;             ///< length of uh_data
 #ifdef U_DEBUG
   int uh_magic;                   ///< magic number to check allocation
 #endif
@@ -72,4 +88,5 @@ enum {
   UH_CHANGED  = 0x01,  ///< b_changed flag before undo/after redo
   UH_EMPTYBUF = 0x02,  ///< buffer was empty
   UH_RELOAD   = 0x04,  ///< buffer was reloaded
+  UH_SHARED   = 0x08,  ///< u_share_lines() was done, not written to file
 };
@@ -0,0 +1,276 @@
+// Watchdog for the main loop: a thread notices when the main loop did not get
+// back to uv_run() for 'stalltime' milliseconds and logs what it was doing.
+//
+// The main loop describes what it is doing in a small stack of "activities"
+// (event handler, RPC method, autocommand, Lua callback).  The watchdog thread
+// only copies that stack, under "watchdog_mutex"; the stall is recorded by the
+// main thread when it gets back to uv_run(), see watchdog_loop_enter().  A
+// callback that uv_run() itself runs, like a luv timer, counts as busy from
+// its watchdog_activity_push() to its watchdog_activity_pop().
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <uv.h>
+
+#include "klib/kvec.h"
+#include "nvim/api/private/defs.h"
+#include "nvim/api/private/helpers.h"
+#include "nvim/ascii_defs.h"
+#include "nvim/log.h"
+#include "nvim/macros_defs.h"
+#include "nvim/memory.h"
+#include "nvim/option_defs.h"
+#include "nvim/option_vars.h"
+#include "nvim/os/time.h"
+#include "nvim/os/time_defs.h"
+#include "nvim/watchdog.h"
+
+enum {
+  ACTIVITY_MAX_DEPTH = 8,   ///< deeper activities are counted, not described
+  ACTIVITY_LEN = 100,       ///< max length of one activity description
+  STALL_MAX_COUNT = 100,    ///< number of stalls kept for nvim__stalls()
+  STALL_ACTIVITY_LEN = ACTIVITY_MAX_DEPTH * (ACTIVITY_LEN + 3),
+};
+
+/// A stall of the main loop, see nvim__stalls().
+typedef struct {
+  Timestamp time;                        ///< when the stall ended
+  uint64_t duration;                     ///< in milliseconds
+  char activity[STALL_ACTIVITY_LEN];     ///< activities when it was detected
+} Stall;
+
+static uv_mutex_t watchdog_mutex;
+static uv_cond_t watchdog_cond;
+static uv_thread_t watchdog_thread;
+/// Only changed by the main thread, with "watchdog_mutex" held.
+static bool watchdog_running = false;
+
+// Protected by "watchdog_mutex" while the watchdog is running.
+static char activity[ACTIVITY_MAX_DEPTH][ACTIVITY_LEN];
+static int activity_depth = 0;
+static uint64_t watchdog_threshold = 0;  ///< 'stalltime' in nanoseconds
+static uint64_t busy_since = 0;          ///< when uv_run() returned, 0 inside uv_run()
+                                         ///< except while a callback runs
+static int busy_depth = -1;              ///< "activity_depth" of the callback that
+                                         ///< set "busy_since" inside uv_run()
+static bool stall_detected = false;      ///< watchdog noticed a stall since "busy_since"
+static char stall_activity[STALL_ACTIVITY_LEN];
+
+/// Stalls recorded by the main thread, oldest first.
+static kvec_t(Stall) stalls = KV_INITIAL_VALUE;
+
+#include "watchdog.c.generated.h"
+
+/// Describes what the main loop is doing, for 'stalltime'.  "kind" is the kind
+/// of activity ("event", "rpc", "autocmd", "lua"), "name" what is running.
+/// Must be paired with watchdog_activity_pop().
+void watchdog_activity_push(const char *kind, const char *name)
+{
+  if (!watchdog_running) {
+    activity_depth++;
+    return;
+  }
+  uv_mutex_lock(&watchdog_mutex);
+  if (activity_depth < ACTIVITY_MAX_DEPTH) {
+    snprintf(activity[activity_depth], ACTIVITY_LEN, "%s %s", kind, name ? name : "?");
+  }
+  if (busy_since == 0) {
+    // A callback inside uv_run(), e.g. a luv timer: busy until it returns.
+    busy_since = os_hrtime();
+    busy_depth = activity_depth;
+  }
+  activity_depth++;
+  uv_mutex_unlock(&watchdog_mutex);
+}
+
+void watchdog_activity_pop(void)
+{
+  if (!watchdog_running) {
+    activity_depth--;
+    return;
+  }
+  uv_mutex_lock(&watchdog_mutex);
+  activity_depth--;
+  bool callback_done = activity_depth == busy_depth;
+  uv_mutex_unlock(&watchdog_mutex);
+  if (callback_done) {
+    // Back inside uv_run().
+    watchdog_loop_enter();
+  }
+}
+
+/// @return  whether watchdog_activity_push() uses its arguments, so that
+///          callers can avoid describing an activity nobody will look at.
+bool watchdog_active(void)
+  FUNC_ATTR_PURE
+{
+  return watchdog_running;
+}
+
+/// Called when the main loop enters uv_run(): the main loop is not stalled.
+void watchdog_loop_enter(void)
+{
+  if (!watchdog_running) {
+    return;
+  }
+  uv_mutex_lock(&watchdog_mutex);
+  bool stalled = stall_detected;
+  uint64_t since = busy_since;
+  Stall stall;
+  if (stalled) {
+    xstrlcpy(stall.activity, stall_activity, sizeof(stall.activity));
+  }
+  stall_detected = false;
+  busy_since = 0;
+  busy_depth = -1;
+  uv_mutex_unlock(&watchdog_mutex);
+
+  if (stalled) {
+    stall.duration = (os_hrtime() - since) / 1000000;
+    stall.time = os_time();
+    WLOG("main loop stalled for %" PRIu64 " ms: %s", stall.duration, stall.activity);
+    if (kv_size(stalls) == STALL_MAX_COUNT) {
+      memmove(&kv_A(stalls, 0), &kv_A(stalls, 1), (kv_size(stalls) - 1) * sizeof(Stall));
+      kv_size(stalls)--;
+    }
+    kv_push(stalls, stall);
+  }
+}
+
+/// Called when the main loop returns from uv_run().
+void watchdog_loop_leave(void)
+{
+  if (!watchdog_running) {
+    return;
+  }
+  uv_mutex_lock(&watchdog_mutex);
+  busy_since = os_hrtime();
+  busy_depth = -1;
+  uv_mutex_unlock(&watchdog_mutex);
+}
+
+/// Copies the activities of the main loop into "stall_activity", innermost
+/// last.  Called with "watchdog_mutex" held.
+static void watchdog_describe(void)
+{
+  size_t len = 0;
+  stall_activity[0] = NUL;
+  for (int i = 0; i < activity_depth && i < ACTIVITY_MAX_DEPTH; i++) {
+    // Activities pushed before the watchdog started are not described.
+    const char *name = activity[i][0] != NUL ? activity[i] : "?";
+    len += (size_t)snprintf(stall_activity + len, sizeof(stall_activity) - len, "%s%s",
+                            i > 0 ? " > " : "", name);
+    if (len >= sizeof(stall_activity)) {
+      break;
+    }
+  }
+  if (activity_depth > ACTIVITY_MAX_DEPTH) {
+    xstrlcat(stall_activity, " > ...", sizeof(stall_activity));
+  } else if (activity_depth == 0) {
+    xstrlcpy(stall_activity, "main loop", sizeof(stall_activity));
+  }
+}
+
+static void watchdog_main(void *arg)
+{
+  uv_mutex_lock(&watchdog_mutex);
+  while (watchdog_running) {
+    // Check four times per 'stalltime', a stall is noticed at most 25% late.
+    uv_cond_timedwait(&watchdog_cond, &watchdog_mutex, MAX(watchdog_threshold / 4, 1000000));
+    if (!watchdog_running || stall_detected || busy_since == 0) {
+      continue;
+    }
+    uint64_t elapsed = os_hrtime() - busy_since;
+    if (elapsed < watchdog_threshold) {
+      continue;
+    }
+    stall_detected = true;
+    watchdog_describe();
+    char desc[STALL_ACTIVITY_LEN];
+    xstrlcpy(desc, stall_activity, sizeof(desc));
+    uv_mutex_unlock(&watchdog_mutex);
+    // Log now, the main loop may never get back to uv_run().
+    WLOG("main loop stalled for more than %" PRIu64 " ms: %s", elapsed / 1000000, desc);
+    uv_mutex_lock(&watchdog_mutex);
+  }
+  uv_mutex_unlock(&watchdog_mutex);
+}
+
+/// Starts the watchdog thread, or applies a new 'stalltime' to it.
+static void watchdog_start(uint64_t threshold_ms)
+{
+  if (watchdog_running) {
+    uv_mutex_lock(&watchdog_mutex);
+    watchdog_threshold = threshold_ms * 1000000;
+    uv_cond_signal(&watchdog_cond);
+    uv_mutex_unlock(&watchdog_mutex);
+    return;
+  }
+
+  static bool did_init = false;
+  if (!did_init) {
+    uv_mutex_init(&watchdog_mutex);
+    uv_cond_init(&watchdog_cond);
+    did_init = true;
+  }
+  watchdog_threshold = threshold_ms * 1000000;
+  memset(activity, 0, sizeof(activity));
+  busy_since = os_hrtime();
+  busy_depth = -1;
+  stall_detected = false;
+  watchdog_running = true;
+  if (uv_thread_create(&watchdog_thread, watchdog_main, NULL) != 0) {
+    ELOG("failed to start the main loop watchdog");
+    watchdog_running = false;
+  }
+}
+
+/// Stops the watchdog thread, if it is running.
+void watchdog_stop(void)
+{
+  if (!watchdog_running) {
+    return;
+  }
+  uv_mutex_lock(&watchdog_mutex);
+  watchdog_running = false;
+  uv_cond_signal(&watchdog_cond);
+  uv_mutex_unlock(&watchdog_mutex);
+  uv_thread_join(&watchdog_thread);
+}
+
+/// Process the new 'stalltime' option value.
+const char *did_set_stalltime(optset_T *args FUNC_ATTR_UNUSED)
+{
+  if (p_stt > 0) {
+    watchdog_start((uint64_t)p_stt);
+  } else {
+    watchdog_stop();
+  }
+  return NULL;
+}
+
+/// Stalls of the main loop recorded since 'stalltime' was set, oldest first.
+Array watchdog_stalls(Arena *arena)
+{
+  Array rv = arena_array(arena, kv_size(stalls));
+  for (size_t i = 0; i < kv_size(stalls); i++) {
+    Stall *stall = &kv_A(stalls, i);
+    Dict d = arena_dict(arena, 3);
+    PUT_C(d, "time", INTEGER_OBJ((Integer)stall->time));
+    PUT_C(d, "duration", INTEGER_OBJ((Integer)stall->duration));
+    PUT_C(d, "activity", CSTR_TO_ARENA_OBJ(arena, stall->activity));
+    ADD_C(rv, DICT_OBJ(d));
+  }
+  return rv;
+}
+
+#ifdef EXITFREE
+void watchdog_free_all_mem(void)
+{
+  watchdog_stop();
+  kv_destroy(stalls);
+}
+#endif
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "nvim/api/private/defs.h"  // IWYU pragma: keep
+#include "nvim/option_defs.h"  // IWYU pragma: keep
+
+#include "watchdog.h.generated.h"
@@ -22,6 +22,7 @@
 #include "nvim/edit.h"
 #include "nvim/errors.h"
 #include "nvim/eval.h"
+#include "nvim/eval/gc.h"
 #include "nvim/eval/typval.h"
 #include "nvim/eval/typval_defs.h"
 #include "nvim/eval/vars.h"
@@ -5322,6 +5323,10 @@ void win_free(win_T *wp, tabpage_T *tp)
   }
 
   xfree(wp->w_lines);
+  kv_destroy(wp->w_decor_cache.marks);
+  for (int i = 0; i < VCOL_CACHE_LINES; i++) {
+    kv_destroy(wp->w_vcol_cache[i].checkpoints);
+  }
 
   for (int i = 0; i < wp->w_tagstacklen; i++) {
     tagstack_clear_entry(&wp->w_tagstack[i]);
@@ -5722,6 +5727,7 @@ static void check_window_scroll_resize(int *size_count, win_T **first_scroll_win
         break;
       }
       d->dv_refcount--;
+      gc_refs_dropped = true;
 
       tot_width += abs(width);
       tot_height += abs(height);
@@ -5740,6 +5746,7 @@ static void check_window_scroll_resize(int *size_count, win_T **first_scroll_win
         tv_dict_unref(alldict);
       } else {
         alldict->dv_refcount--;
+        gc_refs_dropped = true;
       }
     }
   }
@@ -196,4 +196,40 @@ describe('autocmd perf', function()
       N
     )
   end)
+
+  it('nvim_exec_autocmds (many file patterns)', function()
+    exec_lua(
+      [[
+      local N = ...
+
+      for i = 1, N do
+        vim.api.nvim_create_autocmd('BufEnter', {
+          pattern = '*.ext' .. i,
+          command = 'eval 0', -- noop
+        })
+        vim.api.nvim_create_autocmd('FileType', {
+          pattern = 'filetype' .. i,
+          command = 'eval 0', -- noop
+        })
+        vim.api.nvim_create_autocmd('BufEnter', {
+          pattern = 'dir' .. i .. '/*.[ch]',
+          command = 'eval 0', -- noop
+        })
+      end
+
+      start()
+        for i = 1, 100 do
+          vim.api.nvim_exec_autocmds('BufEnter', { pattern = 'file.ext' .. i, modeline = false })
+        end
+      stop('nvim_exec_autocmds BufEnter')
+
+      start()
+        for i = 1, 100 do
+          vim.api.nvim_exec_autocmds('FileType', { pattern = 'filetype' .. i, modeline = false })
+        end
+      stop('nvim_exec_autocmds FileType')
+    ]],
+      N
+    )
+  end)
 end)
@@ -0,0 +1,83 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+local N = 1000000
+
+describe('buffer line access perf', function()
+  before_each(function()
+    clear()
+
+    exec_lua(
+      [[
+      local N = ...
+      local lines = {}
+      for i = 1, N do
+        lines[i] = ('local x%d = %d -- some text to scan'):format(i, i)
+      end
+      lines[N / 2] = 'TODO: needle'
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+
+      out = {}
+      function start()
+        ts = vim.uv.hrtime()
+      end
+      function stop(name)
+        out[#out+1] = ('%14.6f ms - %s'):format((vim.uv.hrtime() - ts) / 1000000, name)
+      end
+    ]],
+      N
+    )
+  end)
+
+  after_each(function()
+    for _, line in ipairs(exec_lua([[return out]])) do
+      print(line)
+    end
+  end)
+
+  it('full scan', function()
+    exec_lua([[
+      local bytes = 0
+
+      start()
+        for _, line in ipairs(vim.api.nvim_buf_get_lines(0, 0, -1, true)) do
+          bytes = bytes + #line
+        end
+      stop('nvim_buf_get_lines')
+
+      local bytes2 = 0
+      start()
+        for _, line in vim.buf_lines(0) do
+          bytes2 = bytes2 + #line
+        end
+      stop('vim.buf_lines')
+
+      assert(bytes == bytes2)
+    ]])
+  end)
+
+  it('regex search', function()
+    exec_lua([[
+      local re = vim.regex("\\<TODO\\>")
+      local found, found2
+
+      start()
+        for i, line in ipairs(vim.api.nvim_buf_get_lines(0, 0, -1, true)) do
+          if re:match_str(line) then
+            found = i - 1
+          end
+        end
+      stop('nvim_buf_get_lines + regex:match_str')
+
+      start()
+        for row in re:match_lines(0) do
+          found2 = row
+        end
+      stop('regex:match_lines')
+
+      assert(found == found2)
+    ]])
+  end)
+end)
@@ -0,0 +1,55 @@
+local n = require('test.functional.testnvim')()
+local Screen = require('test.functional.ui.screen')
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+describe('compositor perf', function()
+  before_each(clear)
+
+  it('move blended floats', function()
+    Screen.new(200, 60)
+
+    local result = exec_lua(function()
+      local lines = {}
+      for i = 1, 60 do
+        lines[i] = ('%d '):format(i):rep(60)
+      end
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+
+      local buf = vim.api.nvim_create_buf(false, true)
+      vim.api.nvim_buf_set_lines(buf, 0, -1, true, { 'notification', 'with a few', 'lines' })
+
+      local wins = {}
+      for i = 1, 20 do
+        local win = vim.api.nvim_open_win(buf, false, {
+          relative = 'editor',
+          row = i,
+          col = i * 5,
+          width = 40,
+          height = 8,
+          zindex = 50 + i,
+        })
+        vim.wo[win].winblend = 30
+        wins[i] = win
+      end
+      vim.cmd('redraw')
+
+      local N = 200
+      local start = vim.uv.hrtime()
+      for step = 1, N do
+        for i, win in ipairs(wins) do
+          vim.api.nvim_win_set_config(win, {
+            relative = 'editor',
+            row = i + step % 20,
+            col = i * 5 + step % 30,
+          })
+        end
+        vim.cmd('redraw')
+      end
+      return (vim.uv.hrtime() - start) / 1e6 / N
+    end)
+
+    print(('%.3f ms per redraw after moving 20 blended floats'):format(result))
+  end)
+end)
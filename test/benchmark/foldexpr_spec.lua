@@ -0,0 +1,73 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+local N = 100000
+
+describe('foldexpr perf', function()
+  before_each(function()
+    clear()
+
+    exec_lua(
+      [[
+      local N = ...
+      local lines = {}
+      for i = 1, N do
+        lines[i] = (' '):rep((i % 4) * 2) .. 'line ' .. i
+      end
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+      vim.o.shiftwidth = 2
+      vim.wo.foldmethod = 'expr'
+
+      out = {}
+      function start()
+        ts = vim.uv.hrtime()
+      end
+      function stop(name)
+        out[#out+1] = ('%14.6f ms - %s'):format((vim.uv.hrtime() - ts) / 1000000, name)
+      end
+    ]],
+      N
+    )
+  end)
+
+  after_each(function()
+    for _, line in ipairs(exec_lua([[return out]])) do
+      print(line)
+    end
+  end)
+
+  it('update folds', function()
+    exec_lua([[
+      local expr = "getline(v:lnum) =~ '^\\s*$' ? '=' : indent(v:lnum) / &shiftwidth"
+
+      vim.wo.foldexpr = expr
+      start()
+        vim.cmd('normal! zx')
+      stop('compiled expression')
+
+      -- A List subscript is not compiled, the expression is evaluated from text.
+      vim.wo.foldexpr = expr .. ' + [0][0]'
+      start()
+        vim.cmd('normal! zx')
+      stop('expression evaluated from text')
+    ]])
+  end)
+
+  it('edit lines', function()
+    exec_lua([[
+      -- Sections of 1000 lines, only the header has an absolute level.
+      vim.wo.foldexpr = "v:lnum % 1000 == 1 ? '>1' : '='"
+      vim.cmd('normal! zx')
+      vim.fn.foldlevel(1)
+
+      start()
+        for i = 1, 1000 do
+          local lnum = 1000 + i * 97 % 1000
+          vim.api.nvim_buf_set_lines(0, lnum - 1, lnum, true, { 'edited ' .. i })
+        end
+      stop('1000 edits in a section')
+    ]])
+  end)
+end)
@@ -0,0 +1,82 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+local N = 1000
+
+describe('option perf', function()
+  before_each(function()
+    clear()
+
+    exec_lua([[
+      out = {}
+      function start()
+        ts = vim.uv.hrtime()
+      end
+      function stop(name)
+        out[#out+1] = ('%14.6f ms - %s'):format((vim.uv.hrtime() - ts) / 1000000, name)
+      end
+    ]])
+  end)
+
+  after_each(function()
+    for _, line in ipairs(exec_lua([[return out]])) do
+      print(line)
+    end
+  end)
+
+  it('configure floating windows', function()
+    exec_lua(
+      [[
+      local N = ...
+      local buf = vim.api.nvim_create_buf(false, true)
+      local config = { relative = 'editor', row = 1, col = 1, width = 20, height = 5 }
+      local values = {
+        number = false,
+        relativenumber = false,
+        cursorline = true,
+        wrap = false,
+        list = false,
+        signcolumn = 'no',
+        foldcolumn = '0',
+        statuscolumn = '',
+        winhighlight = 'Normal:Pmenu,CursorLine:PmenuSel',
+        winblend = 10,
+      }
+
+      local function open(set)
+        for _ = 1, N do
+          set(vim.api.nvim_open_win(buf, false, config))
+        end
+        vim.cmd('redraw')
+      end
+
+      local function close()
+        for _, win in ipairs(vim.api.nvim_list_wins()) do
+          if vim.api.nvim_win_get_config(win).relative ~= '' then
+            vim.api.nvim_win_close(win, true)
+          end
+        end
+      end
+
+      start()
+        open(function(win)
+          for name, value in pairs(values) do
+            vim.api.nvim_set_option_value(name, value, { win = win })
+          end
+        end)
+      stop('nvim_set_option_value() for each option')
+      close()
+
+      start()
+        open(function(win)
+          vim.api.nvim_set_options(values, { win = win })
+        end)
+      stop('nvim_set_options()')
+      close()
+    ]],
+      N
+    )
+  end)
+end)
@@ -0,0 +1,46 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+describe('vcol perf', function()
+  before_each(function()
+    clear()
+
+    exec_lua([[
+      out = {}
+      function start()
+        ts = vim.uv.hrtime()
+      end
+      function stop(name)
+        out[#out+1] = ('%14.6f ms - %s'):format((vim.uv.hrtime() - ts) / 1000000, name)
+      end
+    ]])
+  end)
+
+  after_each(function()
+    for _, line in ipairs(exec_lua([[return out]])) do
+      print(line)
+    end
+  end)
+
+  it('move the cursor in a 1 MB line', function()
+    exec_lua([[
+      local line = ('{"key":\t"value", "中文": [1, 2, 3]}, '):rep(2 ^ 20 / 40)
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, { line })
+      vim.cmd('normal! $')
+
+      start()
+        for _ = 1, 1000 do
+          vim.cmd('normal! h')
+        end
+      stop('1000 times "h" at the end of the line')
+
+      start()
+        for _ = 1, 1000 do
+          vim.fn.virtcol('.')
+        end
+      stop("1000 times virtcol('.')")
+    ]])
+  end)
+end)
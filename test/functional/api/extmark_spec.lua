@@ -1762,6 +1762,94 @@ describe('API/extmarks', function()
     eq({ { 5, 0, 0 } }, get_extmarks(-1, 0, -1, { type = 'virt_lines' }))
   end)
 
+  it('can filter by highlight group', function()
+    set_extmark(ns, 1, 0, 0, { end_col = 1, hl_group = 'Normal' })
+    set_extmark(ns, 2, 0, 1, { end_col = 2, hl_group = { 'Error', 'Search' } })
+    set_extmark(ns, 3, 0, 2, { sign_text = '>>', sign_hl_group = 'Search' })
+    set_extmark(ns, 4, 0, 3, { end_col = 4, hl_group = 'Search', sign_text = '>>' })
+    eq({ { 1, 0, 0 } }, get_extmarks(ns, 0, -1, { hl_group = 'Normal' }))
+    eq({ { 2, 0, 1 }, { 4, 0, 3 } }, get_extmarks(ns, 0, -1, { hl_group = 'Search' }))
+    eq({ { 2, 0, 1 } }, get_extmarks(ns, 0, -1, { hl_group = api.nvim_get_hl_id_by_name('Error') }))
+    eq({ { 4, 0, 3 } }, get_extmarks(ns, 0, -1, { hl_group = 'Search', type = 'sign' }))
+    eq({}, get_extmarks(ns, 0, -1, { hl_group = 'Visual' }))
+  end)
+
+  it('can get marks in pages', function()
+    local lines = {}
+    for i = 1, 1000 do
+      lines[i] = tostring(i)
+    end
+    api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    local has_lines = {}
+    for i = 1, 3000 do
+      local opts = {}
+      if i % 97 == 0 then
+        opts.virt_lines = { { { 'line', 'Normal' } } }
+      end
+      local id = set_extmark(ns, 0, i % 1000, 0, opts)
+      has_lines[id] = opts.virt_lines ~= nil
+    end
+    local all = get_extmarks(ns, 0, -1, {})
+    eq(3000, #all)
+    local function with_lines(marks, first, last)
+      local rv = {}
+      for _, mark in ipairs(marks) do
+        if has_lines[mark[1]] and mark[2] >= first and mark[2] <= last then
+          table.insert(rv, mark)
+        end
+      end
+      return rv
+    end
+
+    local function get_pages(start, end_, opts)
+      local rv = {}
+      local page = get_extmarks(ns, start, end_, opts)
+      while #page > 0 do
+        for _, mark in ipairs(page) do
+          table.insert(rv, mark)
+        end
+        opts.after = page[#page][1]
+        page = get_extmarks(ns, start, end_, opts)
+      end
+      return rv
+    end
+    eq(all, get_pages(0, -1, { limit = 7 }))
+    eq(with_lines(all, 0, 999), get_pages(0, -1, { limit = 2, type = 'virt_lines' }))
+    eq(with_lines(all, 0, 999), get_extmarks(ns, 0, -1, { type = 'virt_lines' }))
+    local range = with_lines(all, 100, 200)
+    eq({ 134, 164, 194 }, { range[1][2], range[2][2], range[3][2] })
+    -- a mark before the range continues from the start of the range
+    eq(range, get_pages({ 100, 0 }, { 200, 0 }, { type = 'virt_lines', after = all[1][1] }))
+    eq(
+      { range[2], range[3] },
+      get_extmarks(ns, { 100, 0 }, { 200, 0 }, { type = 'virt_lines', after = range[1][1] })
+    )
+
+    local msg = "'after' requires a namespace and cannot be used with 'overlap' or a reverse range"
+    eq(msg, pcall_err(get_extmarks, ns, -1, 0, { after = 1 }))
+    eq(msg, pcall_err(get_extmarks, ns, 0, -1, { after = 1, overlap = true }))
+    eq(msg, pcall_err(get_extmarks, -1, 0, -1, { after = 1 }))
+    eq("Invalid 'after': 12345", pcall_err(get_extmarks, ns, 0, -1, { after = 12345 }))
+
+    -- a hidden mark is returned with or without the meta filter
+    local hidden = set_extmark(ns, 0, 500, 0, { virt_lines = { { { 'line' } } }, invalidate = true })
+    has_lines[hidden] = true
+    api.nvim_buf_set_lines(0, 500, 501, true, {})
+    all = get_extmarks(ns, 0, -1, {})
+    local hidden_lines = with_lines(all, 0, 999)
+    local found = false
+    for _, mark in ipairs(hidden_lines) do
+      found = found or mark[1] == hidden
+    end
+    eq(true, found)
+    eq(hidden_lines, get_extmarks(ns, 0, -1, { type = 'virt_lines' }))
+    eq(hidden_lines, get_pages(0, -1, { limit = 2, type = 'virt_lines' }))
+
+    -- a deleted mark cannot be continued from
+    api.nvim_buf_del_extmark(0, ns, hidden)
+    eq(("Invalid 'after': %d"):format(hidden), pcall_err(get_extmarks, ns, 0, -1, { after = hidden }))
+  end)
+
   it('invalidated marks are deleted', function()
     screen = Screen.new(40, 6)
     feed('dd6iaaa bbb ccc<CR><ESC>gg')
@@ -1979,6 +1979,74 @@ describe('API', function()
     end)
   end)
 
+  describe('nvim_get_options, nvim_set_options', function()
+    it('works for a window that is not the current one', function()
+      local config = { relative = 'editor', row = 1, col = 1, width = 9, height = 2 }
+      local win = api.nvim_open_win(0, false, config)
+      api.nvim_set_options(
+        { number = true, wrap = false, winhighlight = 'Normal:Pmenu', statusline = 'x' },
+        { win = win }
+      )
+      eq(
+        { number = true, wrap = false, winhighlight = 'Normal:Pmenu', statusline = 'x' },
+        api.nvim_get_options({ 'number', 'wrap', 'winhighlight', 'statusline' }, { win = win })
+      )
+      eq(
+        { number = false, wrap = true, winhighlight = '' },
+        api.nvim_get_options({ 'number', 'wrap', 'winhighlight' }, {})
+      )
+      -- Like nvim_set_option_value(), the global value of a global-local option is not changed.
+      eq('', api.nvim_get_option_value('statusline', { scope = 'global' }))
+    end)
+
+    it('works for global and buffer options', function()
+      local buf = api.nvim_create_buf(false, true)
+      api.nvim_set_options({ shiftwidth = 3, filetype = 'lua' }, { buf = buf })
+      eq({ shiftwidth = 3, filetype = 'lua' }, api.nvim_get_options({ 'sw', 'ft' }, { buf = buf }))
+      eq(8, api.nvim_get_option_value('shiftwidth', {}))
+      api.nvim_set_options({ equalalways = false, lisp = true }, { scope = 'global' })
+      eq(
+        { equalalways = false, lisp = true },
+        api.nvim_get_options({ 'equalalways', 'lisp' }, { scope = 'global' })
+      )
+      eq(false, api.nvim_get_option_value('lisp', {}))
+    end)
+
+    it('can get default option values for a filetype', function()
+      command('filetype plugin on')
+      command('au FileType lua let g:ft_count = get(g:, "ft_count", 0) + 1')
+      eq(
+        { commentstring = '-- %s', filetype = 'lua' },
+        api.nvim_get_options({ 'commentstring', 'filetype' }, { filetype = 'lua' })
+      )
+      eq(1, api.nvim_get_var('ft_count'))
+      eq('', api.nvim_get_option_value('filetype', {}))
+      eq(
+        "cannot use 'filetype' with 'scope', 'buf' or 'win'",
+        pcall_err(api.nvim_get_options, { 'commentstring' }, { filetype = 'lua', buf = 0 })
+      )
+    end)
+
+    it('checks all names before setting any option', function()
+      local values = { number = true, bogus = 1 }
+      eq("Unknown option 'bogus'", pcall_err(api.nvim_set_options, values, {}))
+      eq(false, api.nvim_get_option_value('number', {}))
+      eq(
+        "'win' cannot be passed for global option 'equalalways'",
+        pcall_err(api.nvim_set_options, { number = true, equalalways = false }, { win = 0 })
+      )
+      eq(false, api.nvim_get_option_value('number', {}))
+      eq("Unknown option 'bogus'", pcall_err(api.nvim_get_options, { 'number', 'bogus' }, {}))
+      eq("Invalid 'name': expected String, got Integer", pcall_err(api.nvim_get_options, { 1 }, {}))
+    end)
+
+    it('triggers OptionSet for each option', function()
+      command('let g:set = [] | autocmd OptionSet * call add(g:set, expand("<amatch>"))')
+      api.nvim_set_options({ number = true, wrap = false }, {})
+      eq({ 'number', 'wrap' }, n.fn.sort(api.nvim_get_var('set')))
+    end)
+  end)
+
   describe('nvim_{get,set}_current_buf, nvim_list_bufs', function()
     it('works', function()
       eq(1, #api.nvim_list_bufs())
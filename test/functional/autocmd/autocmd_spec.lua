@@ -715,4 +715,30 @@ describe('autocmd', function()
       vim.cmd "tabnew"
     ]]
   end)
+
+  it('literal file patterns match like the regexp they stand for', function()
+    exec([[
+      let g:matched = []
+      augroup TestLiteral
+        autocmd User * call add(g:matched, 'any')
+        autocmd User foo.c call add(g:matched, 'exact')
+        autocmd User *.c call add(g:matched, 'suffix')
+        autocmd User foo* call add(g:matched, 'prefix')
+        autocmd User f?o.c call add(g:matched, 'regex')
+      augroup END
+    ]])
+    local function matched(name)
+      command('let g:matched = []')
+      command('silent doautocmd <nomodeline> User ' .. name)
+      return eval('g:matched')
+    end
+    command('set nofileignorecase')
+    eq({ 'any', 'exact', 'suffix', 'prefix', 'regex' }, matched('foo.c'))
+    eq({ 'any', 'suffix' }, matched('bar.c'))
+    eq({ 'any', 'prefix' }, matched('foo.cc'))
+    eq({ 'any' }, matched('FOO.C'))
+    command('set fileignorecase')
+    eq({ 'any', 'exact', 'suffix', 'prefix', 'regex' }, matched('FOO.C'))
+    eq({ 'any', 'suffix' }, matched('ä.C'))
+  end)
 end)
@@ -99,4 +99,42 @@ describe('log', function()
     -- Child Nvim spawned by jobstart() prepends "c/" to parent name.
     assert_log('c/' .. tid .. '%.%d+%.%d +server_init:%d+: test log message', testlog, 100)
   end)
+
+  it("stalls of the main loop with 'stalltime'", function()
+    clear({ env = { NVIM_LOG_FILE = testlog } })
+    command('set stalltime=100')
+    command('lua vim.uv.sleep(300)')
+    exec_lua(function()
+      vim.schedule(function()
+        vim.uv.sleep(300)
+      end)
+    end)
+    n.poke_eventloop()
+
+    local stalls = request('nvim__stalls')
+    eq('event request_event > rpc nvim_command', stalls[1].activity)
+    assert(stalls[1].duration >= 250)
+    t.matches('^event nlua_schedule_event > lua .+:%d+$', stalls[#stalls].activity)
+    assert_log('main loop stalled for %d+ ms: event request_event > rpc nvim_command', testlog, 100)
+
+    command('set stalltime=0')
+    command('lua vim.uv.sleep(300)')
+    eq(#stalls, #request('nvim__stalls'))
+  end)
+
+  it("stalls in a vim.uv callback with 'stalltime'", function()
+    clear({ env = { NVIM_LOG_FILE = testlog } })
+    command('set stalltime=100')
+    exec_lua(function()
+      vim.uv.new_timer():start(0, 0, function()
+        vim.uv.sleep(300)
+      end)
+    end)
+    t.retry(nil, 2000, function()
+      eq(1, #request('nvim__stalls'))
+    end)
+    local stall = request('nvim__stalls')[1]
+    t.matches('^lua .+:%d+$', stall.activity)
+    assert(stall.duration >= 250)
+  end)
 end)
@@ -76,6 +76,38 @@ describe('startup', function()
     assert_log("require%('vim%._editor'%)", testfile, 100)
   end)
 
+  it('--startuptime writes a trace to a .json file', function()
+    local testfile = 'Xtest_startuptime.json'
+    finally(function()
+      os.remove(testfile)
+    end)
+    clear({ args = { '--startuptime', testfile } })
+    local events --- @type table[]
+    retry(nil, 1000, function()
+      local text = assert(read_file(testfile))
+      matches('NVIM STARTED', text)
+      -- The closing bracket is left out, so that more processes can append.
+      events = vim.json.decode(text:gsub(',%s*$', '') .. ']')
+    end)
+    eq({ 'process_name', 'M', 'Embedded' }, { events[1].name, events[1].ph, events[1].args.name })
+
+    local spans = {} --- @type table<string,table>
+    for _, ev in ipairs(events) do
+      if ev.ph == 'X' then
+        spans[ev.name] = ev
+      end
+    end
+    local function inside(inner, outer)
+      return outer.ts <= inner.ts and inner.ts + inner.dur <= outer.ts + outer.dur
+    end
+    local require_span = spans["require('vim._editor')"]
+    ok(require_span ~= nil)
+    ok(inside(require_span, spans['init lua interpreter']))
+    -- Steps of starting up follow each other.
+    local lua_span = spans['init lua interpreter']
+    ok(lua_span.ts + lua_span.dur <= spans['--- NVIM STARTED ---'].ts)
+  end)
+
   it('--startuptime does not crash on error #31125', function()
     local p = n.spawn_wait('--startuptime', '.', '-c', '42cquit')
     eq("E484: Can't open file .", p.stderr)
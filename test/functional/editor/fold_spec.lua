@@ -425,6 +425,41 @@ a]],
     eq(14, fn.foldclosedend(11))
   end)
 
+  it('fdm=expr relative levels are updated correctly after changes', function()
+    exec([[
+      setlocal foldmethod=expr
+      setlocal foldexpr=getline(v:lnum)=~'^#'?'>1':getline(v:lnum)=~'^{'?'a1':getline(v:lnum)=~'^}'?'s1':'='
+      call setline(1, ['# a', 'x', '{', 'x', 'x', '}', 'x', '# b', 'x', '{', 'x', '{', 'x', '}', 'x', '}', 'x'])
+    ]])
+    local function levels()
+      local l = {}
+      for lnum = 1, fn.line('$') do
+        l[lnum] = fn.foldlevel(lnum)
+      end
+      return l
+    end
+    local function check()
+      local updated = levels()
+      command('normal! zx')
+      eq(levels(), updated)
+    end
+    check()
+    fn.setline(11, '{') -- a1 instead of =
+    check()
+    fn.setline(13, 'y') -- same level, different text
+    check()
+    fn.setline(12, 'x') -- = instead of a1
+    check()
+    command('5delete')
+    check()
+    fn.append(8, { '{', 'x' })
+    check()
+    fn.setline(7, '# c')
+    check()
+    command('1,3delete')
+    check()
+  end)
+
   it('fdm=expr works correctly with :move #18668', function()
     exec([[
       set foldmethod=expr foldexpr=indent(v:lnum)
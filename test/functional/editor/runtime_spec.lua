@@ -5,6 +5,7 @@ local clear = n.clear
 local eq = t.eq
 local eval = n.eval
 local exec = n.exec
+local exec_lua = n.exec_lua
 local api = n.api
 local fn = n.fn
 local mkdir_p = n.mkdir_p
@@ -424,6 +425,56 @@ describe('runtime:', function()
     eq(sid, api.nvim_get_option_info2('mouse', {}).last_set_sid)
   end)
 
+  it('finds files added to or removed from a directory searched before', function()
+    -- Use an absolute path, directories below it are cached in the runtime file index.
+    exec('set rtp& | set rtp^=' .. fn.fnamemodify(plug_dir, ':p'))
+    local index_folder = table.concat({ plug_dir, 'Xindex' }, sep)
+    mkdir_p(index_folder)
+    write_file(table.concat({ index_folder, 'a.vim' }, sep), [[let g:seq ..= 'a']])
+    exec('let g:seq = "" | runtime! Xindex/*.vim Xindex/b.vim')
+    eq('a', eval('g:seq'))
+
+    write_file(table.concat({ index_folder, 'b.vim' }, sep), [[let g:seq ..= 'b']])
+    exec('let g:seq = "" | runtime! Xindex/*.vim Xindex/b.vim')
+    eq('abb', eval('g:seq'))
+
+    -- Files written and deleted by Nvim itself are seen right away.
+    exec(([[
+      let g:seq = ""
+      call writefile(["let g:seq ..= 'c'"], '%s')
+      call delete('%s')
+      runtime! Xindex/*.vim Xindex/b.vim
+    ]]):format(
+      table.concat({ index_folder, 'c.vim' }, sep),
+      table.concat({ index_folder, 'a.vim' }, sep)
+    ))
+    eq('bcb', eval('g:seq'))
+
+    -- So are files written by other means before a lookup in the same command.
+    eq(
+      'bcdb',
+      exec_lua(function(fname)
+        local f = assert(io.open(fname, 'w'))
+        f:write([[let g:seq ..= 'd']])
+        f:close()
+        vim.cmd([[let g:seq = "" | runtime! Xindex/*.vim Xindex/b.vim]])
+        return vim.g.seq
+      end, table.concat({ index_folder, 'd.vim' }, sep))
+    )
+
+    local lua_folder = table.concat({ plug_dir, 'lua' }, sep)
+    mkdir_p(lua_folder)
+    eq(false, exec_lua([[return (pcall(require, 'Xindexmod'))]]))
+    write_file(table.concat({ lua_folder, 'Xindexmod.lua' }, sep), [[return 42]])
+    eq(42, exec_lua([[return require('Xindexmod')]]))
+
+    -- Directories that are no longer in 'runtimepath' are not searched.
+    exec('set rtp& | let g:seq = "" | runtime! Xindex/*.vim')
+    eq('', eval('g:seq'))
+    exec('set rtp^=' .. fn.fnamemodify(plug_dir, ':p') .. ' | runtime! Xindex/*.vim')
+    eq('bcd', eval('g:seq'))
+  end)
+
   it('cpp ftplugin loads c ftplugin #29053', function()
     eq('', eval('&commentstring'))
     eq('', eval('&omnifunc'))
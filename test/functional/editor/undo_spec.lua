@@ -225,3 +225,143 @@ describe(':undo! command', function()
     )
   end)
 end)
+
+describe('undo file', function()
+  before_each(clear)
+  after_each(function()
+    os.remove('Xundofile')
+  end)
+
+  local function reload_undo()
+    exec([[
+      let lines = getline(1, '$')
+      enew!
+      call setline(1, lines)
+      rundo Xundofile
+    ]])
+  end
+
+  local function file_version()
+    local data = t.read_file('Xundofile')
+    return data:byte(10) * 256 + data:byte(11)
+  end
+
+  it('is written in the old format when it can', function()
+    insert('1')
+    feed('o2<esc>')
+    command('wundo Xundofile')
+    -- Older versions of Nvim can read it.
+    eq(3, file_version())
+    reload_undo()
+    command('wundo Xundofile')
+    eq(3, file_version())
+  end)
+
+  it('keeps all branches when written and read back', function()
+    insert('1')
+    feed('o2<esc>')
+    feed('o3<esc>')
+    feed('uu')
+    feed('o4<esc>')
+    local tree = fn.undotree()
+    command('wundo Xundofile')
+    reload_undo()
+    eq(tree, fn.undotree())
+    -- Write the file again before any change was used.
+    command('wundo Xundofile')
+    reload_undo()
+    eq(tree, fn.undotree())
+
+    command('undo 3')
+    expect('1\n2\n3')
+    command('undo 0')
+    expect('')
+    command('undo 4')
+    expect('1\n4')
+    feed('u')
+    expect('1')
+    feed('<C-r>')
+    expect('1\n4')
+  end)
+end)
+
+describe('undo of a large change', function()
+  before_each(clear)
+  after_each(function()
+    os.remove('Xundofile')
+  end)
+
+  it('restores lines containing a NUL', function()
+    local old, new = exec_lua(function()
+      local old = {}
+      for i = 1, 1000 do
+        old[i] = 'line ' .. i
+      end
+      old[5] = 'a\000b'
+      old[500] = 'x\000y\000z'
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, old)
+      vim.cmd('let &undolevels = &undolevels')
+      local new = vim.deepcopy(old)
+      new[3] = 'c\000d'
+      table.insert(new, 400, 'inserted')
+      new[800] = 'changed 800'
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, new)
+      vim.cmd('let &undolevels = &undolevels')
+      return old, new
+    end)
+    local function lines()
+      return n.api.nvim_buf_get_lines(0, 0, -1, true)
+    end
+
+    feed('u')
+    eq(old, lines())
+    feed('<C-r>')
+    eq(new, lines())
+    feed('u')
+    eq(old, lines())
+  end)
+
+  it('restores lines that are not stored separately', function()
+    local old, new = exec_lua(function()
+      local old = {}
+      for i = 1, 1000 do
+        old[i] = 'line ' .. i
+      end
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, old)
+      vim.cmd('let &undolevels = &undolevels')
+      local new = vim.deepcopy(old)
+      new[10] = 'changed 10'
+      table.insert(new, 700, 'inserted')
+      table.remove(new, 900)
+      new[#new] = 'changed last'
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, new)
+      vim.cmd('let &undolevels = &undolevels')
+      return old, new
+    end)
+    local function lines()
+      return n.api.nvim_buf_get_lines(0, 0, -1, true)
+    end
+
+    feed('u')
+    eq(old, lines())
+    feed('<C-r>')
+    eq(new, lines())
+    feed('u')
+    eq(old, lines())
+    feed('<C-r>')
+
+    -- Also when written to an undo file and read back.
+    command('wundo Xundofile')
+    eq(4, t.read_file('Xundofile'):byte(11))
+    exec([[
+      let lines = getline(1, '$')
+      enew!
+      call setline(1, lines)
+      rundo Xundofile
+    ]])
+    feed('u')
+    eq(old, lines())
+    feed('<C-r>')
+    eq(new, lines())
+  end)
+end)
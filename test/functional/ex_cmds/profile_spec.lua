@@ -93,4 +93,53 @@ describe(':profile', function()
       matches('Called 1 time', profile)
     end)
   end)
+
+  describe('sample', function()
+    it('writes folded stacks of Lua and Vimscript', function()
+      source([[
+        function! Busy()
+          let start = reltime()
+          while reltimefloat(reltime(start)) < 0.2
+          endwhile
+        endfunction
+      ]])
+      n.exec_lua([[
+        function _G.LuaBusy()
+          local start = vim.uv.hrtime()
+          while vim.uv.hrtime() - start < 2e8 do
+          end
+        end
+      ]])
+      command('profile sample ' .. tempfile)
+      eq(0, eval('v:profiling'))
+      command('call Busy()')
+      command('lua LuaBusy()')
+      assert_file_exists_not(tempfile)
+      command('profile stop')
+      local stacks = read_file(tempfile)
+      matches('\nfunction Busy %d+\n', '\n' .. stacks)
+      if n.exec_lua('return package.loaded.jit ~= nil') then
+        -- Without LuaJIT, Lua code is only sampled when it calls Vimscript.
+        matches('LuaBusy [^;\n]*:%d+ %d+\n', stacks)
+      end
+      eq('Vim(profile):E750: First use ":profile start {fname}"', n.exc_exec('profile dump'))
+    end)
+
+    it('keeps a hook set with debug.sethook()', function()
+      n.exec_lua(function()
+        _G.hook = function() end
+        debug.sethook(_G.hook, 'c')
+      end)
+      command('profile sample ' .. tempfile)
+      n.exec_lua('for _ = 1, 1e5 do end')
+      command('profile stop')
+      eq(
+        { true, 'c' },
+        n.exec_lua(function()
+          local hook, mask = debug.gethook()
+          return { hook == _G.hook, mask }
+        end)
+      )
+    end)
+  end)
 end)
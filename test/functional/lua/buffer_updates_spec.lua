@@ -1678,6 +1678,84 @@ describe('lua: nvim_buf_attach on_bytes', function()
   end)
 end)
 
+describe('lua: nvim_buf_attach on_changes', function()
+  before_each(function()
+    exec_lua(function()
+      _G.calls = {}
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, origlines)
+      _G.text = table.concat(vim.api.nvim_buf_get_lines(0, 0, -1, true), '\n') .. '\n'
+      vim.api.nvim_buf_attach(0, false, {
+        on_changes = function(_, _, _, changes)
+          table.insert(_G.calls, changes or vim.NIL)
+          if not changes then
+            return
+          end
+          -- Changes moving forward: the new text of each one is at the same
+          -- place in the final text.
+          local final = table.concat(vim.api.nvim_buf_get_lines(0, 0, -1, true), '\n') .. '\n'
+          for i = 1, #changes, 9 do
+            local start, old, new = changes[i + 2], changes[i + 5], changes[i + 8]
+            _G.text = _G.text:sub(1, start)
+              .. final:sub(start + 1, start + new)
+              .. _G.text:sub(start + old + 1)
+          end
+        end,
+      })
+    end)
+  end)
+
+  local function check(ncalls)
+    n.poke_eventloop()
+    eq(
+      { ncalls, fn.join(fn.getline(1, '$'), '\n') .. '\n' },
+      exec_lua(function()
+        return { #_G.calls, _G.text }
+      end)
+    )
+    return exec_lua('return _G.calls')
+  end
+
+  it('merges typed text', function()
+    feed('ifoo<Esc>')
+    eq({ { 0, 0, 0, 0, 0, 0, 0, 3, 3 } }, check(1))
+    feed('Abar<CR>baz<Esc>')
+    check(2)
+  end)
+
+  it('passes the changes of :substitute at once', function()
+    command('%s/line/LINE/g')
+    local changes = check(1)[1]
+    eq(7 * 9, #changes)
+    eq({ 0, 9, 9, 0, 4, 4, 0, 4, 4 }, { unpack(changes, 1, 9) })
+  end)
+
+  it('passes nil after too many changes', function()
+    exec_lua(function()
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, vim.fn['repeat']({ 'a' }, 2000))
+    end)
+    n.poke_eventloop()
+    command('%s/a/bb/')
+    n.poke_eventloop()
+    eq({ vim.NIL }, exec_lua('return { _G.calls[2] }'))
+  end)
+
+  it('can detach', function()
+    exec_lua(function()
+      vim.api.nvim_buf_attach(0, false, {
+        on_changes = function()
+          _G.calls2 = (_G.calls2 or 0) + 1
+          return true
+        end,
+      })
+    end)
+    feed('ifoo<Esc>')
+    check(1)
+    feed('ibar<Esc>')
+    check(2)
+    eq(1, exec_lua('return _G.calls2'))
+  end)
+end)
+
 describe('nvim_buf_attach on_detach', function()
   it('called before buf_freeall autocommands', function()
     exec_lua(function()
@@ -86,6 +86,43 @@ describe('thread', function()
     assert_alive()
   end)
 
+  it('does not keep changes from a previous thread', function()
+    eq(
+      { 'nil nil nil nil table nil', 'nil nil nil nil table nil' },
+      exec_lua(function()
+        local results = {}
+        for _ = 1, 2 do
+          local async
+          async = vim.uv.new_async(function(ret)
+            results[#results + 1] = ret
+            async:close()
+          end)
+          local thread = vim.uv.new_thread(function(a)
+            a:send(table.concat({
+              tostring(Leaked),
+              tostring(string.leaked),
+              tostring(vim.json.leaked),
+              tostring(debug.getregistry().leaked),
+              type(vim.json.decode),
+              tostring((debug.gethook())),
+            }, ' '))
+            Leaked = true
+            string.leaked = true
+            vim.json.leaked = true
+            debug.getregistry().leaked = true
+            vim.json.decode = nil
+            debug.sethook(function() end, 'c')
+          end, async)
+          vim.uv.thread_join(thread)
+        end
+        vim.wait(1000, function()
+          return #results == 2
+        end)
+        return results
+      end)
+    )
+  end)
+
   describe('print', function()
     it('works', function()
       exec_lua [[
@@ -1768,11 +1768,66 @@ describe('lua stdlib', function()
     eq({}, exec_lua [[return {re1:match_line(0, 1, 1, 7)}]])
     eq({ 0, 3 }, exec_lua [[return {re1:match_line(0, 1, 0, 7)}]])
 
+    api.nvim_buf_set_lines(0, 0, -1, true, { 'abc', 'yy', 'xabbbc', 'ac' })
+    eq(
+      { { 0, 0, 3 }, { 2, 1, 6 } },
+      exec_lua [[
+        local t = {}
+        for row, s, e in re1:match_lines(0) do
+          t[#t + 1] = { row, s, e }
+        end
+        return t
+      ]]
+    )
+    eq({ { 2, 1, 6 } }, exec_lua [[return vim.iter(re1:match_lines(0, 1, -2)):totable()]])
+    matches('invalid end', pcall_err(exec_lua, [[re1:match_lines(0, 0, 5)]]))
+
     -- vim.regex() error inside :silent! should not crash. #20546
     command([[silent! lua vim.regex('\\z')]])
     assert_alive()
   end)
 
+  it('vim.buf_lines', function()
+    api.nvim_buf_set_lines(0, 0, -1, true, { 'a', 'b\000c', '', 'd' })
+    eq(
+      { { 0, 'a' }, { 1, 'b\000c' }, { 2, '' }, { 3, 'd' } },
+      exec_lua [[return vim.iter(vim.buf_lines(0)):totable()]]
+    )
+    eq(
+      { { 1, 'b\000c' }, { 2, '' } },
+      exec_lua [[return vim.iter(vim.buf_lines(0, 1, -2)):totable()]]
+    )
+    eq({}, exec_lua [[return vim.iter(vim.buf_lines(0, 2, 2)):totable()]])
+
+    -- stops at the current end of a buffer that shrinks while iterating
+    eq(
+      { 'a', 'b\000c' },
+      exec_lua [[
+        local t = {}
+        for row, line in vim.buf_lines(0) do
+          t[#t + 1] = line
+          if row == 1 then
+            vim.api.nvim_buf_set_lines(0, 2, -1, true, {})
+          end
+        end
+        return t
+      ]]
+    )
+
+    matches('invalid start', pcall_err(exec_lua, [[vim.buf_lines(0, 5)]]))
+    matches('invalid end', pcall_err(exec_lua, [[vim.buf_lines(0, 0, 5)]]))
+    matches('invalid buffer', pcall_err(exec_lua, [[vim.buf_lines(42)]]))
+    eq(
+      'invalid buffer',
+      exec_lua [[
+        local buf = vim.api.nvim_create_buf(false, true)
+        local it = vim.buf_lines(buf)
+        vim.api.nvim_buf_delete(buf, { force = true })
+        return select(2, pcall(it)):match('invalid buffer')
+      ]]
+    )
+  end)
+
   it('vim.defer_fn', function()
     eq(
       false,
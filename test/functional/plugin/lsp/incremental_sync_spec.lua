@@ -734,6 +734,36 @@ describe('incremental synchronization', function()
         '\n'
       )
     end)
+    for encoding, character in pairs({ ['utf-8'] = 6, ['utf-16'] = 4, ['utf-32'] = 3 }) do
+      it('inserting after a character outside the BMP with ' .. encoding, function()
+        local expected_text_changes = {
+          {
+            range = {
+              ['start'] = {
+                character = character,
+                line = 0,
+              },
+              ['end'] = {
+                character = character,
+                line = 0,
+              },
+            },
+            rangeLength = 0,
+            text = 'x',
+          },
+        }
+        test_edit({ 'a🔥bc' }, { '$ix' }, expected_text_changes, encoding, '\n')
+      end)
+    end
+  end)
+
+  it('reports a missing line', function()
+    local err = exec_lua(function()
+      local sync = require('vim.lsp.sync')
+      local _, e = pcall(sync.compute_diff, { 'a' }, {}, 0, 1, 2, 'utf-16', '\n')
+      return e
+    end)
+    t.matches('no line at index 1 of curr_lines', err)
   end)
 end)
 
@@ -177,6 +177,38 @@ describe('ShaDa support code', function()
     eq(2, nvim_current_line())
   end)
 
+  it('reads local marks written by another instance after startup', function()
+    nvim_command('edit ' .. testfilename)
+    nvim_command('mark a')
+    expect_exit(nvim_command, 'qall')
+    reset()
+    -- Marks of files loaded after startup are read from the index built at
+    -- startup, until the ShaDa file changes.
+    nvim_command('edit ' .. testfilename_2)
+    local p = n.spawn_wait {
+      args_rm = {
+        '-i',
+        '--embed', -- no --embed
+      },
+      args = {
+        '-i',
+        api.nvim_get_var('tmpname'), -- Use same shada file as parent.
+        '-c',
+        'edit ' .. testfilename,
+        '-c',
+        '2',
+        '-c',
+        'mark a',
+        '-c',
+        'qall',
+      },
+    }
+    eq(0, p.status)
+    nvim_command('edit ' .. testfilename)
+    nvim_command('normal! `a')
+    eq(2, nvim_current_line())
+  end)
+
   it('is able to dump and read back mark "', function()
     nvim_command('edit ' .. testfilename)
     nvim_command('2')
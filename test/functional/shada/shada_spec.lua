@@ -276,6 +276,18 @@ describe('ShaDa support code', function()
     )
   end)
 
+  it(":wshada writes in the background with 'shadaasync'", function()
+    nvim_command('set shadaasync shada+=!')
+    nvim_command('let g:SHADA_ASYNC_1 = 1')
+    nvim_command('wshada ' .. shada_fname)
+    -- The second write merges the file written by the first one.
+    nvim_command('unlet g:SHADA_ASYNC_1 | let g:SHADA_ASYNC_2 = 2')
+    nvim_command('wshada ' .. shada_fname)
+    nvim_command('rshada ' .. shada_fname)
+    eq({ 1, 2 }, fn.eval('[g:SHADA_ASYNC_1, g:SHADA_ASYNC_2]'))
+    eq(nil, uv.fs_stat(shada_fname .. '.tmp.a'))
+  end)
+
   it(':wshada/:rshada without arguments is no-op when shadafile=NONE', function()
     nvim_command('set shadafile=NONE')
     nvim_command('wshada')
@@ -1167,6 +1167,56 @@ describe('extmark decorations', function()
     screen:expect_unchanged()
   end)
 
+  it('redraws marks changed between redraws of only the cursor line', function()
+    screen:try_resize(50, 6)
+    command('hi! CursorLine guibg=NONE')
+    command('set cursorline')
+    insert([[
+      aaa
+      bbb
+      ccc
+      ddd]])
+    api.nvim_buf_set_extmark(0, ns, 0, 0, { end_col = 3, hl_group = 'ErrorMsg' })
+    local id = api.nvim_buf_set_extmark(0, ns, 2, 0, { end_col = 3, hl_group = 'ErrorMsg' })
+    screen:expect([[
+      {4:aaa}                                               |
+      bbb                                               |
+      {4:ccc}                                               |
+      dd^d                                               |
+      {1:~                                                 }|
+                                                        |
+    ]])
+    feed('k')
+    screen:expect([[
+      {4:aaa}                                               |
+      bbb                                               |
+      {4:cc^c}                                               |
+      ddd                                               |
+      {1:~                                                 }|
+                                                        |
+    ]])
+    api.nvim_buf_del_extmark(0, ns, id)
+    feed('k')
+    screen:expect([[
+      {4:aaa}                                               |
+      bb^b                                               |
+      ccc                                               |
+      ddd                                               |
+      {1:~                                                 }|
+                                                        |
+    ]])
+    -- Marks move with the text.
+    feed('ggO<Esc>j')
+    screen:expect([[
+                                                        |
+      {4:^aaa}                                               |
+      bbb                                               |
+      ccc                                               |
+      ddd                                               |
+                                                        |
+    ]])
+  end)
+
   it('can have virtual text of overlay position', function()
     insert(example_text)
     feed 'gg'
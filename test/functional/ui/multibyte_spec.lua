@@ -126,6 +126,18 @@ describe('multibyte rendering', function()
     ]])
   end)
 
+  it('double-width chars and tabs far right in a long line with nowrap', function()
+    command('set nowrap')
+    -- Each 'ab口d<Tab>' takes 8 cells.
+    api.nvim_buf_set_lines(0, 0, -1, true, { ('ab口d\t'):rep(20000) })
+    fn.winrestview({ lnum = 1, col = 7 * 9995 + 5, leftcol = 8 * 9995 + 4 })
+    screen:expect([[
+      ^d   ab口d   ab口d   ab口d   ab口d   ab口d   ab口d   ab口d   |
+      {1:~                                                           }|*4
+                                                                  |
+    ]])
+  end)
+
   it('0xffff is shown as 4 hex digits', function()
     command([[call setline(1, "\uFFFF!!!")]])
     feed('$')
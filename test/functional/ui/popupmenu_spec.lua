@@ -883,7 +883,7 @@ describe("builtin popupmenu 'pumblend'", function()
     ]])
 
     feed('Obla bla <c-x><c-n>')
-    screen:expect([[
+    local blend10 = [[
       Lorem ipsum d{10:ol}or sit amet, consectetur                     |
       adipisicing elit, sed do eiusmod tempor                     |
       bla bla incididunt^                                          |
@@ -898,7 +898,8 @@ describe("builtin popupmenu 'pumblend'", function()
       Ut enim{103: }{104:enim}{103:inim veniam}{100:,} quis nostrud                       |
       {2:[No Nam}{112:e}{135:ad}{112:[+]          }{113: }{2:                                    }|
       {5:-- Keyword Local completion (^N^P) }{6:match 1 of 65}            |
-    ]])
+    ]]
+    screen:expect(blend10)
 
     command('set pumblend=0')
     screen:expect([[
@@ -919,7 +920,7 @@ describe("builtin popupmenu 'pumblend'", function()
     ]])
 
     command('set pumblend=50')
-    screen:expect([[
+    local blend50 = [[
       Lorem ipsum d{10:ol}or sit amet, consectetur                     |
       adipisicing elit, sed do eiusmod tempor                     |
       bla bla incididunt^                                          |
@@ -934,7 +935,14 @@ describe("builtin popupmenu 'pumblend'", function()
       Ut enim{119: }{120:enim}{119:inim veniam}{116:,} quis nostrud                       |
       {2:[No Nam}{130:e}{137:ad}{130:[+]          }{132: }{2:                                    }|
       {5:-- Keyword Local completion (^N^P) }{6:match 1 of 65}            |
-    ]])
+    ]]
+    screen:expect(blend50)
+
+    -- blends computed for another 'pumblend' value are not reused
+    command('set pumblend=10')
+    screen:expect(blend10)
+    command('set pumblend=50')
+    screen:expect(blend50)
 
     api.nvim_input_mouse('wheel', 'down', '', 0, 9, 40)
     screen:expect([[
@@ -16,6 +16,7 @@ local Screen = require('test.functional.ui.screen')
 local mkdir = t.mkdir
 local clear = n.clear
 local eq = t.eq
+local matches = t.matches
 local exec = n.exec
 local exc_exec = n.exc_exec
 local exec_lua = n.exec_lua
@@ -225,6 +226,74 @@ describe('listing functions using :function', function()
   end)
 end)
 
+describe('comment and empty lines in functions', function()
+  before_each(clear)
+
+  it('do not affect heredoc, nested functions or line numbers', function()
+    exec([[
+      func Outer()
+        " comment
+
+        let text =<< trim END
+          " not a comment
+
+        END
+        func! g:Inner()
+          " inner comment
+          return expand('<slnum>')
+        endfunc
+        :
+        return [text, expand('<slnum>')]
+      endfunc
+    ]])
+    eq({ { '" not a comment', '' }, '12' }, eval('Outer()'))
+    eq('2', eval('Inner()'))
+    matches('" inner comment', exec_capture('function Inner'))
+  end)
+end)
+
+describe('expression options', function()
+  before_each(clear)
+
+  local function foldlevels()
+    command('normal! zx')
+    return exec_lua(function()
+      local levels = {}
+      for lnum = 1, vim.fn.line('$') do
+        levels[lnum] = vim.fn.foldlevel(lnum)
+      end
+      return levels
+    end)
+  end
+
+  it('are evaluated with current values each time', function()
+    api.nvim_buf_set_lines(0, 0, -1, true, { 'a', '  b', '    c', '', 'x' })
+    exec([[
+      let g:lvl = 1
+      func Lvl(lnum)
+        return g:lvl
+      endfunc
+      set shiftwidth=2 foldmethod=expr
+      let &foldexpr = "getline(v:lnum) =~ '^$' ? '=' : "
+            \ .. "indent(v:lnum) / &shiftwidth + Lvl(v:lnum) - (getline(v:lnum) =~ 'X')"
+    ]])
+    eq({ 1, 2, 3, 3, 1 }, foldlevels())
+    command('set ignorecase shiftwidth=4')
+    eq({ 1, 1, 2, 2, 0 }, foldlevels())
+    command('let g:lvl = 2')
+    eq({ 2, 2, 3, 3, 1 }, foldlevels())
+  end)
+
+  it('work for indentexpr and expressions that are not compiled', function()
+    api.nvim_buf_set_lines(0, 0, -1, true, { 'a', 'b' })
+    command([[set foldmethod=expr foldexpr=[0,1,2][v:lnum]]])
+    eq({ 1, 2 }, foldlevels())
+    command([[setlocal indentexpr=-(2\ *\ -&sw)\ .\ ''  shiftwidth=3]])
+    command('normal! gg=G')
+    eq({ '      a', '      b' }, api.nvim_buf_get_lines(0, 0, -1, true))
+  end)
+end)
+
 it('no double-free in garbage collection #16287', function()
   clear()
   -- Don't use exec() here as using a named script reproduces the issue better.
@@ -0,0 +1,47 @@
+local t = require('test.testutil')
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local command = n.command
+local eq = t.eq
+local eval = n.eval
+local retry = t.retry
+
+describe('gcstats()', function()
+  before_each(function()
+    clear()
+    command('set updatetime=1')
+  end)
+
+  it('returns statistics', function()
+    eq(
+      { 'count', 'interrupted', 'last', 'max', 'skipped', 'total' },
+      eval('sort(keys(gcstats()))')
+    )
+    local stats = eval('gcstats()')
+    eq('number', type(stats.count))
+    eq('number', type(stats.last))
+    eq(true, stats.last <= stats.max and stats.max <= stats.total)
+  end)
+
+  it('counts collections while waiting for a key', function()
+    local count = eval('gcstats().count')
+    command('let l = [] | call add(l, l) | unlet l')
+    retry(nil, 1000, function()
+      eq(count + 1, eval('gcstats().count'))
+    end)
+    -- Nothing was dropped since, so waiting again does not collect.
+    local skipped = eval('gcstats().skipped')
+    retry(nil, 1000, function()
+      eq(true, eval('gcstats().skipped') > skipped)
+    end)
+  end)
+
+  it('garbagecollect() collects even when nothing was dropped', function()
+    local count = eval('gcstats().count')
+    command('call garbagecollect()')
+    retry(nil, 1000, function()
+      eq(count + 1, eval('gcstats().count'))
+    end)
+  end)
+end)
@@ -0,0 +1,67 @@
+local t = require('test.testutil')
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local command = n.command
+local eq = t.eq
+local exec_lua = n.exec_lua
+
+describe('virtcol() in a long line', function()
+  before_each(function()
+    clear()
+    command('set nowrap')
+    exec_lua(function()
+      local parts = { 'abc', '\t', '中文', 'x\t\t', 'é' }
+      local line = {}
+      for i = 1, 2000 do
+        line[i] = parts[i % #parts + 1]
+      end
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, { table.concat(line) })
+    end)
+  end)
+
+  --- Checks virtcol() against strdisplaywidth() of the text before the column.
+  local function check()
+    eq(
+      {},
+      exec_lua(function()
+        local line = vim.api.nvim_get_current_line()
+        local bad = {}
+        for col = 1, #line, 97 do
+          col = vim.str_utf_start(line, col) + col
+          local start = vim.fn.virtcol({ 1, col }, true)[1]
+          local expected = vim.fn.strdisplaywidth(line:sub(1, col - 1)) + 1
+          if start ~= expected then
+            bad[#bad + 1] = { col, start, expected }
+          end
+        end
+        local width = vim.fn.virtcol({ 1, '$' }) - 1
+        if width ~= vim.fn.strdisplaywidth(line) then
+          bad[#bad + 1] = { '$', width, vim.fn.strdisplaywidth(line) }
+        end
+        return bad
+      end)
+    )
+  end
+
+  it('is correct after changing text or options', function()
+    check()
+    -- Same length, different widths.
+    exec_lua(function()
+      vim.api.nvim_buf_set_text(0, 0, 10, 0, 13, { '\t\t\t' })
+    end)
+    check()
+    command('set tabstop=3')
+    check()
+    command('set list listchars=tab:>-')
+    check()
+    command('set ambiwidth=double')
+    check()
+    exec_lua(function()
+      vim.api.nvim_buf_set_text(0, 0, 0, 0, 0, { '\1\2\3' })
+    end)
+    check()
+    command('set display+=uhex')
+    check()
+  end)
+end)